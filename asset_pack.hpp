@@ -0,0 +1,159 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// asset packs
+// one file holding every asset already decoded, so that the game maps it and
+// hands the bytes straight to SDL. Layout (little endian):
+//   AssetPackHeader | AssetEntry * count | data...
+// images are tightly packed rgba32 pixels, sounds are pcm in the mixer's output
+// format, anything else (music, streamed by the mixer) is kept as it was.
+// Every entry's data starts ASSET_ALIGNMENT aligned
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+#include "file_io.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+static_assert(std::endian::native == std::endian::little, "asset packs are stored little endian and mapped as they are");
+
+constexpr uint8_t ASSET_PACK_MAGIC[4]{'C', 'Z', 'P', 'K'};
+constexpr uint32_t ASSET_PACK_VERSION{1};
+constexpr size_t ASSET_NAME_SIZE{32};
+constexpr uint64_t ASSET_ALIGNMENT{16};
+constexpr const char *ASSET_PACK_FILE{"assets.czpak"}; // looked for in the assets directory
+
+enum AssetKind : uint32_t
+{
+    ASSET_IMAGE = 1, // rgba32 pixels, width * height * 4 bytes
+    ASSET_PCM = 2,   // samples in the format below, ready for Mix_QuickLoad_RAW
+    ASSET_BLOB = 3,  // the file as it was
+};
+
+struct AssetPackHeader
+{
+    uint8_t magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+static_assert(sizeof(AssetPackHeader) == 16);
+
+struct AssetEntry
+{
+    char name[ASSET_NAME_SIZE]; // file name the asset was packed from, nul terminated
+    uint32_t kind;
+    uint32_t width;     // images
+    uint32_t height;    // images
+    uint32_t frequency; // pcm
+    uint16_t channels;  // pcm
+    uint16_t format;    // pcm, an SDL audio format
+    uint32_t reserved;
+    uint64_t offset; // from the start of the pack
+    uint64_t size;
+};
+static_assert(sizeof(AssetEntry) == 72);
+
+// a memory-mapped pack; entries and their bytes are handed out in place
+class AssetPack
+{
+public:
+    explicit AssetPack(const std::string &path) : m_file{path}, m_count{}
+    {
+        if (m_file.size() < sizeof(AssetPackHeader))
+        {
+            error(std::format("'{}' is not an asset pack", path));
+        }
+        const AssetPackHeader &header{*reinterpret_cast<const AssetPackHeader *>(m_file.data())};
+        if (std::memcmp(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic)) != 0)
+        {
+            error(std::format("'{}' is not an asset pack", path));
+        }
+        if (header.version != ASSET_PACK_VERSION)
+        {
+            error(std::format("'{}' has asset pack version {} (expected {})", path, header.version, ASSET_PACK_VERSION));
+        }
+        if ((m_file.size() - sizeof(AssetPackHeader)) / sizeof(AssetEntry) < header.count)
+        {
+            error(std::format("'{}' is truncated", path));
+        }
+        m_count = header.count;
+
+        for (size_t i{}; i < m_count; i++)
+        {
+            const AssetEntry &entry{entries()[i]};
+            bool is_named{std::memchr(entry.name, '\0', sizeof(entry.name)) != nullptr};
+            bool is_inside{entry.offset <= m_file.size() && entry.size <= m_file.size() - entry.offset};
+            bool is_image_sized{entry.kind != ASSET_IMAGE || uint64_t{entry.width} * entry.height * 4 == entry.size};
+            if (!is_named || !is_inside || !is_image_sized || entry.offset % ASSET_ALIGNMENT != 0)
+            {
+                error(std::format("'{}' has a corrupted entry {}", path, i));
+            }
+        }
+    }
+
+public:
+    // the entry packed from file 'name', or null
+    const AssetEntry *find(std::string_view name) const noexcept
+    {
+        for (size_t i{}; i < m_count; i++)
+        {
+            if (name == entries()[i].name)
+            {
+                return &entries()[i];
+            }
+        }
+        return nullptr;
+    }
+    const uint8_t *data(const AssetEntry &entry) const noexcept { return m_file.data() + entry.offset; }
+
+private:
+    const AssetEntry *entries() const noexcept
+    {
+        return reinterpret_cast<const AssetEntry *>(m_file.data() + sizeof(AssetPackHeader));
+    }
+
+private:
+    MappedFile m_file;
+    size_t m_count;
+};
+
+// builds a pack in memory; write() lays it out and saves it
+class AssetPackWriter
+{
+public:
+    void add(AssetEntry entry, const uint8_t *bytes, size_t size)
+    {
+        entry.size = size;
+        m_entries.push_back(entry);
+        m_data.emplace_back(bytes, bytes + size);
+    }
+    void write(const std::string &path) const
+    {
+        std::vector<uint8_t> pack(sizeof(AssetPackHeader) + m_entries.size() * sizeof(AssetEntry));
+        std::vector<AssetEntry> entries{m_entries};
+        for (size_t i{}; i < entries.size(); i++)
+        {
+            pack.resize((pack.size() + ASSET_ALIGNMENT - 1) / ASSET_ALIGNMENT * ASSET_ALIGNMENT);
+            entries[i].offset = pack.size();
+            pack.insert(pack.end(), m_data[i].begin(), m_data[i].end());
+        }
+
+        AssetPackHeader header{};
+        std::memcpy(header.magic, ASSET_PACK_MAGIC, sizeof(header.magic));
+        header.version = ASSET_PACK_VERSION;
+        header.count = static_cast<uint32_t>(entries.size());
+        std::memcpy(pack.data(), &header, sizeof(header));
+        std::memcpy(pack.data() + sizeof(header), entries.data(), entries.size() * sizeof(AssetEntry));
+        write_file(path, pack);
+    }
+
+private:
+    std::vector<AssetEntry> m_entries{};
+    std::vector<std::vector<uint8_t>> m_data{};
+};
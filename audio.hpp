@@ -0,0 +1,223 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// sound effects
+// the simulation never talks to the mixer: it pushes a command per game event
+// onto a lock-free queue and moves on. The dispatcher drains the queue, drops
+// repeats of an effect within the same tick and plays the rest on channels it
+// owns, taking a channel over from a less important sound when all are busy
+// ----------------------------------------------------------------------------
+
+#include <SDL2/SDL_mixer.h>
+
+#include "sim.hpp"
+#include "spsc_ring.hpp"
+
+#include <cstdint>
+#include <format>
+
+constexpr int AUDIO_CHANNELS{8};           // mixer channels the dispatcher allocates and manages
+constexpr size_t AUDIO_QUEUE_CAPACITY{64}; // commands in flight; a frame queues at most a handful
+constexpr int SOUND_EFFECT_COUNT{GAME_EVENT_SPAWN + 1};
+
+struct SoundEffects
+{
+    Mix_Chunk *gift;
+    Mix_Chunk *house;
+    Mix_Chunk *hurt;
+    Mix_Chunk *step;
+    Mix_Chunk *spawn;
+};
+
+// play 'effect', which happened on simulation tick 'tick'
+struct SoundCommand
+{
+    GameEvent effect;
+    uint32_t tick;
+};
+
+using AudioQueue = SpscRing<SoundCommand, AUDIO_QUEUE_CAPACITY>;
+
+// queue a sound for every event of a tick; never blocks, and a full queue (the
+// dispatcher stopped draining) loses the sounds rather than stalling the tick
+inline void push_game_events(AudioQueue &queue, const GameEvents &events, uint32_t tick) noexcept
+{
+    for (int i{}; i < events.count; i++)
+    {
+        queue.try_push(SoundCommand{events.items[i], tick});
+    }
+}
+
+// which sound keeps its channel when there are too many at once: getting hurt
+// must be heard, one more footstep need not
+inline int sound_priority(GameEvent effect)
+{
+    int priority{};
+    switch (effect)
+    {
+    case GAME_EVENT_STEP:
+    {
+        priority = 0;
+    }
+    break;
+    case GAME_EVENT_SPAWN:
+    {
+        priority = 1;
+    }
+    break;
+    case GAME_EVENT_GIFT:
+    {
+        priority = 2;
+    }
+    break;
+    case GAME_EVENT_HOUSE:
+    {
+        priority = 3;
+    }
+    break;
+    case GAME_EVENT_HURT:
+    {
+        priority = 4;
+    }
+    break;
+    default:
+    {
+        unreachable();
+    }
+    }
+    return priority;
+}
+
+inline Mix_Chunk *sound_chunk(const SoundEffects &sfx, GameEvent effect)
+{
+    Mix_Chunk *chunk{};
+    switch (effect)
+    {
+    case GAME_EVENT_STEP:
+    {
+        chunk = sfx.step;
+    }
+    break;
+    case GAME_EVENT_GIFT:
+    {
+        chunk = sfx.gift;
+    }
+    break;
+    case GAME_EVENT_HOUSE:
+    {
+        chunk = sfx.house;
+    }
+    break;
+    case GAME_EVENT_HURT:
+    {
+        chunk = sfx.hurt;
+    }
+    break;
+    case GAME_EVENT_SPAWN:
+    {
+        chunk = sfx.spawn;
+    }
+    break;
+    default:
+    {
+        unreachable();
+    }
+    }
+    return chunk;
+}
+
+struct AudioStats
+{
+    int64_t played;
+    int64_t coalesced; // repeats of an effect in a tick that already played it
+    int64_t replaced;  // played over a less important sound
+    int64_t dropped;   // every channel busy with something at least as important
+};
+
+// the consumer end of an AudioQueue; call dispatch() from a single thread
+class AudioDispatcher
+{
+public:
+    AudioDispatcher(const SoundEffects &sfx, AudioQueue &queue)
+        : m_sfx{sfx}, m_queue{queue}, m_channel_priority{}, m_last_tick{}, m_has_played{}, m_stats{}
+    {
+        int channels{Mix_AllocateChannels(AUDIO_CHANNELS)};
+        if (channels != AUDIO_CHANNELS)
+        {
+            error(std::format("failed to allocate {} mixer channels (got {}): {}", AUDIO_CHANNELS, channels, Mix_GetError()));
+        }
+    }
+    ~AudioDispatcher() noexcept = default;
+    AudioDispatcher(const AudioDispatcher &) noexcept = delete;
+    AudioDispatcher(AudioDispatcher &&) noexcept = delete;
+    AudioDispatcher &operator=(const AudioDispatcher &) noexcept = delete;
+    AudioDispatcher &operator=(AudioDispatcher &&) noexcept = delete;
+
+public:
+    void dispatch()
+    {
+        SoundCommand command{};
+        while (m_queue.try_pop(command))
+        {
+            // the same effect twice in a tick sounds like once, only louder and clipped
+            if (m_has_played[command.effect] && m_last_tick[command.effect] == command.tick)
+            {
+                m_stats.coalesced++;
+                continue;
+            }
+            m_has_played[command.effect] = true;
+            m_last_tick[command.effect] = command.tick;
+
+            Mix_Chunk *chunk{sound_chunk(m_sfx, command.effect)};
+            if (!chunk) // headless runs have no sounds
+            {
+                continue;
+            }
+            int priority{sound_priority(command.effect)};
+            int channel{pick_channel(priority)};
+            if (channel < 0)
+            {
+                m_stats.dropped++;
+                continue;
+            }
+            if (Mix_PlayChannel(channel, chunk, 0) == channel)
+            {
+                m_channel_priority[channel] = priority;
+                m_stats.played++;
+            }
+        }
+    }
+    const AudioStats &stats() const noexcept { return m_stats; }
+
+private:
+    // a free channel, else the one playing the least important sound if it is
+    // less important than 'priority', else -1
+    int pick_channel(int priority)
+    {
+        int victim{-1};
+        for (int channel{}; channel < AUDIO_CHANNELS; channel++)
+        {
+            if (Mix_Playing(channel) == 0)
+            {
+                return channel;
+            }
+            if (m_channel_priority[channel] < priority && (victim < 0 || m_channel_priority[channel] < m_channel_priority[victim]))
+            {
+                victim = channel;
+            }
+        }
+        if (victim >= 0)
+        {
+            m_stats.replaced++;
+        }
+        return victim;
+    }
+
+private:
+    const SoundEffects &m_sfx;
+    AudioQueue &m_queue;
+    int m_channel_priority[AUDIO_CHANNELS]; // of the sound each channel last started
+    uint32_t m_last_tick[SOUND_EFFECT_COUNT];
+    bool m_has_played[SOUND_EFFECT_COUNT];
+    AudioStats m_stats;
+};
@@ -0,0 +1,365 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// autopilot
+// plays by itself, for soak and load tests. Without bags it heads for the
+// nearest gift, with bags for the nearest house (or more gifts if there is no
+// house), along an A* path over the wrapping board. Bags are obstacles until
+// the tick the trail leaves them, and so is the trail santa lays down along
+// the path. The plan is kept between ticks and only checked against the board:
+// when a spawn or the trail blocks it, the steps before the blockage are kept
+// and only the rest is searched again
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+constexpr int AUTOPILOT_MAX_EXPANSIONS{4096}; // a search gives up after this many tiles, so a tick stays cheap on any board
+constexpr int AUTOPILOT_NEVER{INT_MAX};       // enter time of a tile that would end the game
+
+struct AutopilotStats
+{
+    int64_t ticks;
+    int64_t replans; // searches from santa
+    int64_t repairs; // searches from the last good step of a blocked plan
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+template <int ROWS, int COLS>
+class Autopilot
+{
+public:
+    using State = BasicGameState<ROWS, COLS>;
+
+public:
+    // point santa_direction where the plan goes next
+    void steer(State &state)
+    {
+        auto start{std::chrono::steady_clock::now()};
+        prepare(state);
+
+        int santa{tile_index(state.board, state.santa)};
+        if (!is_plan_valid(state, santa))
+        {
+            replan(state, santa);
+        }
+        if (m_cursor < m_plan.size())
+        {
+            state.santa_direction = m_plan[m_cursor].direction;
+            m_expected = m_plan[m_cursor].tile;
+            m_cursor++;
+        }
+        else
+        {
+            survive(state, santa);
+        }
+
+        uint64_t ns{static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count())};
+        m_stats.ticks++;
+        m_stats.total_ns += ns;
+        m_stats.max_ns = std::max(m_stats.max_ns, ns);
+    }
+    const AutopilotStats &stats() const noexcept { return m_stats; }
+
+private:
+    struct Step
+    {
+        int tile;            // where santa is after the step
+        Direction direction; // the way he walks to get there
+    };
+
+    struct OpenNode
+    {
+        int f;
+        int g;
+        int tile;
+    };
+
+private:
+    // size the scratch for the board and note the rank of every bag in the trail
+    void prepare(const State &state)
+    {
+        size_t tiles{static_cast<size_t>(state.board.rows() * state.board.cols())};
+        if (m_bag_rank.size() != tiles)
+        {
+            m_bag_rank.assign(tiles, 0);
+            m_search_stamp.assign(tiles, 0);
+            m_g.assign(tiles, 0);
+            m_parent.assign(tiles, Step{});
+            m_trail_stamp.assign(tiles, 0);
+            m_trail_time.assign(tiles, 0);
+            m_plan.clear();
+        }
+        for (int i{}; i < state.num_bags; i++)
+        {
+            m_bag_rank[static_cast<size_t>(tile_index(state.board, bag_at(state, i)))] = i;
+        }
+    }
+
+    bool is_set(const State &state, TileType type, int tile) const noexcept
+    {
+        return (state.board.mask(type)[tile / 64] >> (tile % 64)) & 1;
+    }
+
+    // the first step (counting from now) at which santa can walk onto 'tile'
+    int enter_time(const State &state, int tile) const noexcept
+    {
+        int time{};
+        if (is_set(state, TILE_BAG, tile))
+        {
+            // the bag 'rank' places from santa leaves with the (num_bags - rank)-th step
+            time = state.num_bags - m_bag_rank[static_cast<size_t>(tile)] + 1;
+        }
+        else if (is_set(state, TILE_HOUSE, tile) && state.num_bags == 0)
+        {
+            time = AUTOPILOT_NEVER;
+        }
+        if (m_trail_stamp[static_cast<size_t>(tile)] == m_trail_generation)
+        {
+            time = std::max(time, m_trail_time[static_cast<size_t>(tile)]);
+        }
+        return time;
+    }
+
+    // the plan still starts where santa is, still leads to its target, and every
+    // step of it is still free by the time santa gets there; a blocked plan is
+    // repaired from its last good step when there is one
+    bool is_plan_valid(const State &state, int santa)
+    {
+        next_trail_generation();
+        if (m_cursor >= m_plan.size() || santa != m_expected || !is_set(state, m_target_type, m_target))
+        {
+            return false;
+        }
+        for (size_t i{m_cursor}; i < m_plan.size(); i++)
+        {
+            int time{static_cast<int>(i - m_cursor) + 1};
+            if (enter_time(state, m_plan[i].tile) > time)
+            {
+                return i > m_cursor && repair(state, santa, i);
+            }
+        }
+        return true;
+    }
+
+    // keep the steps before 'blocked' and search on from the last of them, with
+    // the trail they lay down in the way
+    bool repair(const State &state, int santa, size_t blocked)
+    {
+        m_stats.repairs++;
+        if (state.num_bags > 0)
+        {
+            lay_trail(state, santa, 0);
+            for (size_t i{m_cursor}; i + 1 < blocked; i++)
+            {
+                lay_trail(state, m_plan[i].tile, static_cast<int>(i - m_cursor) + 1);
+            }
+        }
+        const Step &last{m_plan[blocked - 1]};
+        int elapsed{static_cast<int>(blocked - m_cursor)};
+        std::vector<Step> &suffix{m_scratch_path};
+        if (!search(state, last.tile, elapsed, last.direction, m_target, suffix))
+        {
+            return false;
+        }
+        m_plan.erase(m_plan.begin() + static_cast<std::ptrdiff_t>(blocked), m_plan.end());
+        m_plan.insert(m_plan.end(), suffix.begin(), suffix.end());
+        return true;
+    }
+
+    // forget every trail laid so far; the stamps are cleared when the generation wraps
+    void next_trail_generation()
+    {
+        m_trail_generation++;
+        if (m_trail_generation == 0)
+        {
+            std::fill(m_trail_stamp.begin(), m_trail_stamp.end(), 0);
+            m_trail_generation = 1;
+        }
+    }
+
+    // santa leaves 'tile' with step 'time' + 1, and the trail keeps it covered until num_bags steps later
+    void lay_trail(const State &state, int tile, int time)
+    {
+        m_trail_stamp[static_cast<size_t>(tile)] = m_trail_generation;
+        m_trail_time[static_cast<size_t>(tile)] = time + state.num_bags + 2;
+    }
+
+    void replan(const State &state, int santa)
+    {
+        m_stats.replans++;
+        m_plan.clear();
+        m_cursor = 0;
+        m_expected = santa;
+        next_trail_generation();
+
+        // gifts first; with bags, houses to deliver them, or more gifts while there are no houses
+        TileType type{state.num_bags > 0 ? TILE_HOUSE : TILE_GIFT};
+        int target{nearest(state, santa, type)};
+        if (target < 0 && type == TILE_HOUSE)
+        {
+            type = TILE_GIFT;
+            target = nearest(state, santa, type);
+        }
+        if (target < 0)
+        {
+            return;
+        }
+        m_target = target;
+        m_target_type = type;
+        search(state, santa, 0, state.santa_direction, target, m_plan);
+    }
+
+    // the tile of 'type' closest to 'from' as the crow flies over the wrapping board, or -1
+    int nearest(const State &state, int from, TileType type) const noexcept
+    {
+        const uint64_t *mask{state.board.mask(type)};
+        int best{-1};
+        int best_distance{INT_MAX};
+        for (int word{}; word < state.board.words(); word++)
+        {
+            for (uint64_t bits{mask[word]}; bits; bits &= bits - 1)
+            {
+                int tile{word * 64 + std::countr_zero(bits)};
+                int d{distance(state, from, tile)};
+                if (d < best_distance)
+                {
+                    best = tile;
+                    best_distance = d;
+                }
+            }
+        }
+        return best;
+    }
+
+    int distance(const State &state, int from, int to) const noexcept
+    {
+        v2 a{index_tile(state.board, from)};
+        v2 b{index_tile(state.board, to)};
+        int d_row{std::abs(a.row - b.row)};
+        int d_col{std::abs(a.col - b.col)};
+        return std::min(d_row, state.board.rows() - d_row) + std::min(d_col, state.board.cols() - d_col);
+    }
+
+    // the same step the rules take
+    int neighbor(const State &state, int tile, Direction direction) const noexcept
+    {
+        v2 t{index_tile(state.board, tile)};
+        v2 delta{DIRECTION_DELTA[direction]};
+        return tile_index(state.board, v2{state.board.wrap_row(t.row + delta.row), state.board.wrap_col(t.col + delta.col)});
+    }
+
+    // a* from 'start', reached 'start_time' steps from now heading 'heading', to 'target';
+    // steps are unit cost so g is also the step a tile is reached on. Fills 'path' with
+    // the steps after 'start', false if the target is out of reach (or out of budget)
+    bool search(const State &state, int start, int start_time, Direction heading, int target, std::vector<Step> &path)
+    {
+        path.clear();
+        m_search_generation++;
+        if (m_search_generation == 0)
+        {
+            std::fill(m_search_stamp.begin(), m_search_stamp.end(), 0);
+            m_search_generation = 1;
+        }
+        auto is_worse{[](const OpenNode &a, const OpenNode &b) { return a.f > b.f || (a.f == b.f && a.g < b.g); }};
+
+        m_open.clear();
+        m_search_stamp[static_cast<size_t>(start)] = m_search_generation;
+        m_g[static_cast<size_t>(start)] = 0;
+        m_open.push_back(OpenNode{distance(state, start, target), 0, start});
+        int expansions{};
+        while (!m_open.empty() && expansions < AUTOPILOT_MAX_EXPANSIONS)
+        {
+            std::pop_heap(m_open.begin(), m_open.end(), is_worse);
+            OpenNode node{m_open.back()};
+            m_open.pop_back();
+            if (node.g > m_g[static_cast<size_t>(node.tile)])
+            {
+                continue; // a shorter way here was found after this one was queued
+            }
+            if (node.tile == target)
+            {
+                for (int tile{target}; tile != start; tile = m_parent[static_cast<size_t>(tile)].tile)
+                {
+                    path.push_back(Step{tile, m_parent[static_cast<size_t>(tile)].direction});
+                }
+                std::reverse(path.begin(), path.end());
+                return true;
+            }
+            expansions++;
+
+            for (int d{DIRECTION_NORTH}; d <= DIRECTION_EAST; d++)
+            {
+                Direction direction{static_cast<Direction>(d)};
+                // with bags santa cannot turn back on himself
+                if (node.tile == start && state.num_bags > 0 && direction == opposite_direction(heading))
+                {
+                    continue;
+                }
+                int next{neighbor(state, node.tile, direction)};
+                int g{node.g + 1};
+                if (enter_time(state, next) > start_time + g)
+                {
+                    continue;
+                }
+                size_t n{static_cast<size_t>(next)};
+                if (m_search_stamp[n] == m_search_generation && m_g[n] <= g)
+                {
+                    continue;
+                }
+                m_search_stamp[n] = m_search_generation;
+                m_g[n] = g;
+                m_parent[n] = Step{node.tile, direction};
+                m_open.push_back(OpenNode{g + distance(state, next, target), g, next});
+                std::push_heap(m_open.begin(), m_open.end(), is_worse);
+            }
+        }
+        return false;
+    }
+
+    // nothing to go for, or no way there: keep going straight if that is safe,
+    // otherwise take any safe turn
+    void survive(State &state, int santa)
+    {
+        auto is_safe{[&](Direction direction) { return can_turn(state, direction) && enter_time(state, neighbor(state, santa, direction)) <= 1; }};
+        if (is_safe(state.santa_direction))
+        {
+            return;
+        }
+        for (int d{DIRECTION_NORTH}; d <= DIRECTION_EAST; d++)
+        {
+            if (is_safe(static_cast<Direction>(d)))
+            {
+                state.santa_direction = static_cast<Direction>(d);
+                return;
+            }
+        }
+    }
+
+private:
+    std::vector<Step> m_plan{};
+    size_t m_cursor{};     // next step of the plan to take
+    int m_expected{-1};    // where santa should be if the last step went as planned
+    int m_target{};
+    TileType m_target_type{};
+    std::vector<int> m_bag_rank{};          // per tile, valid where the board has a bag
+    std::vector<uint32_t> m_search_stamp{}; // per tile, == m_search_generation once the current search reached it
+    uint32_t m_search_generation{};
+    std::vector<int> m_g{};
+    std::vector<Step> m_parent{}; // the tile a search came from, and the way it stepped
+    std::vector<OpenNode> m_open{};
+    std::vector<uint32_t> m_trail_stamp{}; // per tile, == m_trail_generation where the planned path lays trail
+    std::vector<int> m_trail_time{};
+    uint32_t m_trail_generation{};
+    std::vector<Step> m_scratch_path{};
+    AutopilotStats m_stats{};
+};
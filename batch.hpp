@@ -0,0 +1,164 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// batch simulator
+// owns many independent games and steps them in parallel on a thread pool,
+// restarting every game that ends so that the cores never run out of work
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+#include "autopilot.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// a player picks santa's direction before every tick
+template <typename State>
+using Player = void (*)(State &state, Rng &rng);
+
+// a player that turns randomly now and then, but never turns back onto its bags
+template <typename State>
+inline void random_player(State &state, Rng &rng)
+{
+    if (random_int(rng, 1, 4) == 1)
+    {
+        Direction direction{static_cast<Direction>(random_int(rng, DIRECTION_NORTH, DIRECTION_EAST))};
+        if (can_turn(state, direction))
+        {
+            state.santa_direction = direction;
+        }
+    }
+}
+
+// a player that follows the autopilot; each worker thread keeps one, and a plan
+// left over from another game fails validation and is simply replaced
+template <typename State>
+inline void autopilot_player(State &state, Rng & /*rng*/)
+{
+    thread_local Autopilot<State::BOARD_ROWS, State::BOARD_COLS> autopilot{};
+    autopilot.steer(state);
+}
+
+template <typename State>
+struct BatchGame
+{
+    State state;
+    Rng player_rng; // kept apart from the game generator so players don't perturb spawns
+};
+
+struct BatchStats
+{
+    int64_t ticks;
+    int64_t games_finished;
+    int64_t deliveries;
+    double elapsed_sec;
+    double ticks_per_sec;
+};
+
+// 'State' is any BasicGameState; every game starts as a copy of 'prototype',
+// which is how the board size of dynamic boards gets chosen
+template <typename State>
+class BatchSimulator
+{
+public:
+    BatchSimulator(const State &prototype, int num_games, int num_threads, uint64_t seed, Player<State> player)
+        : m_games{}, m_pool{num_threads}, m_player{player}
+    {
+        if (num_games <= 0)
+        {
+            error(std::format("batch simulator needs at least one game (got {})", num_games));
+        }
+
+        // every game and every player gets its own stream of the batch seed,
+        // so whole batches are reproducible
+        m_games.resize(static_cast<size_t>(num_games), BatchGame<State>{prototype, Rng{}});
+        for (size_t i{}; i < m_games.size(); i++)
+        {
+            seed_rng(m_games[i].state.rng, seed, 2 * i);
+            seed_rng(m_games[i].player_rng, seed, 2 * i + 1);
+            init_game_state(m_games[i].state);
+        }
+    }
+    ~BatchSimulator() noexcept = default;
+    BatchSimulator(const BatchSimulator &) noexcept = delete;
+    BatchSimulator(BatchSimulator &&) noexcept = delete;
+    BatchSimulator &operator=(const BatchSimulator &) noexcept = delete;
+    BatchSimulator &operator=(BatchSimulator &&) noexcept = delete;
+
+public:
+    int num_games() const noexcept { return static_cast<int>(m_games.size()); }
+    const State &game(int index) const { return m_games[static_cast<size_t>(index)].state; }
+    // replace a game, e.g. to start from a snapshot instead of a new game
+    void set_game(int index, const State &state) { m_games[static_cast<size_t>(index)].state = state; }
+
+    // advance every game by 'ticks' ticks
+    BatchStats run(int64_t ticks)
+    {
+        std::atomic<int64_t> games_finished{};
+        std::atomic<int64_t> deliveries{};
+
+        // a few tasks per thread, so that stealing can even out unlucky splits
+        size_t num_tasks{static_cast<size_t>(m_pool.size()) * 8};
+        size_t games_per_task{std::max<size_t>(1, (m_games.size() + num_tasks - 1) / num_tasks)};
+
+        auto start{std::chrono::steady_clock::now()};
+        for (size_t first{}; first < m_games.size(); first += games_per_task)
+        {
+            size_t last{std::min(first + games_per_task, m_games.size())};
+            m_pool.submit([this, first, last, ticks, &games_finished, &deliveries]() {
+                BatchStats stats{step_games(first, last, ticks)};
+                games_finished.fetch_add(stats.games_finished, std::memory_order_relaxed);
+                deliveries.fetch_add(stats.deliveries, std::memory_order_relaxed);
+            });
+        }
+        m_pool.wait_idle();
+        auto end{std::chrono::steady_clock::now()};
+
+        BatchStats stats{};
+        stats.ticks = ticks * static_cast<int64_t>(m_games.size());
+        stats.games_finished = games_finished.load();
+        stats.deliveries = deliveries.load();
+        stats.elapsed_sec = std::chrono::duration<double>(end - start).count();
+        stats.ticks_per_sec = static_cast<double>(stats.ticks) / stats.elapsed_sec;
+        return stats;
+    }
+
+private:
+    BatchStats step_games(size_t first, size_t last, int64_t ticks)
+    {
+        BatchStats stats{};
+        for (size_t i{first}; i < last; i++)
+        {
+            BatchGame<State> &game{m_games[i]};
+            for (int64_t tick{}; tick < ticks; tick++)
+            {
+                m_player(game.state, game.player_rng);
+                GameEvents events{update_game_state(game.state)};
+                for (int e{}; e < events.count; e++)
+                {
+                    if (events.items[e] == GAME_EVENT_HOUSE)
+                    {
+                        stats.deliveries++;
+                    }
+                }
+
+                // restart finished games right away
+                if (game.state.game_over)
+                {
+                    init_game_state(game.state);
+                    stats.games_finished++;
+                }
+            }
+        }
+        return stats;
+    }
+
+private:
+    std::vector<BatchGame<State>> m_games;
+    ThreadPool m_pool;
+    Player<State> m_player;
+};
@@ -0,0 +1,357 @@
+// microbenchmarks for the hot paths: the rules one branch at a time, whole
+// games, the autopilot, the solver, the swarm, the game scene rendering against the software renderer and asset
+// loading, loose and packed. Prints one json object per line so runs can be
+// diffed and tracked:
+//   {"name": "...", "iterations": N, "ns_per_op": median, "ns_per_op_min": min}
+
+#include "game.hpp"
+#include "batch.hpp"
+#include "solver.hpp"
+#include "swarm.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+constexpr double BENCH_TARGET_SEC{0.05}; // how long one repetition should run for
+constexpr int BENCH_REPETITIONS{5};
+
+// keeps the optimizer from dropping work whose result is never looked at
+template <typename T>
+static void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+template <typename Op>
+static double time_iterations(Op &op, int64_t iterations)
+{
+    auto start{std::chrono::steady_clock::now()};
+    for (int64_t i{}; i < iterations; i++)
+    {
+        op();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// grow the iteration count until a repetition takes about BENCH_TARGET_SEC, then
+// report the median and the fastest of a few repetitions
+template <typename Op>
+static void run_benchmark(const std::string &name, const std::string &filter, Op op)
+{
+    if (!filter.empty() && name.find(filter) == std::string::npos)
+    {
+        return;
+    }
+
+    int64_t iterations{1};
+    double elapsed_sec{time_iterations(op, iterations)};
+    while (elapsed_sec < BENCH_TARGET_SEC / 10.0)
+    {
+        iterations *= 2;
+        elapsed_sec = time_iterations(op, iterations);
+    }
+    iterations = std::max(int64_t{1}, static_cast<int64_t>(static_cast<double>(iterations) * BENCH_TARGET_SEC / elapsed_sec));
+
+    std::vector<double> ns_per_op{};
+    for (int i{}; i < BENCH_REPETITIONS; i++)
+    {
+        ns_per_op.push_back(time_iterations(op, iterations) * 1e9 / static_cast<double>(iterations));
+    }
+    std::sort(ns_per_op.begin(), ns_per_op.end());
+
+    std::cout << std::format("{{\"name\": \"{}\", \"iterations\": {}, \"ns_per_op\": {:.2f}, \"ns_per_op_min\": {:.2f}}}\n", name, iterations, ns_per_op[ns_per_op.size() / 2], ns_per_op.front());
+}
+
+// santa in the middle of the board facing west, with the spawn timer far from going off
+static GameState fresh_state()
+{
+    GameState state{};
+    seed_rng(state.rng, 1);
+    init_game_state(state);
+    return state;
+}
+
+// the fresh state with three bags trailing east of santa
+static GameState state_with_bags()
+{
+    GameState state{fresh_state()};
+    for (int col{state.santa.col + 3}; col > state.santa.col; col--)
+    {
+        set_tile(state.board, v2{state.santa.row, col}, TILE_BAG);
+        push_first_bag(state, v2{state.santa.row, col});
+    }
+    return state;
+}
+
+// what santa steps onto on the next tick
+static GameState state_facing(GameState state, TileType type)
+{
+    set_tile(state.board, v2{state.santa.row, state.santa.col - 1}, type);
+    return state;
+}
+
+// one tick from a copy of 'prototype', so every iteration takes the same branch
+static void bench_tick(const std::string &name, const std::string &filter, const GameState &prototype)
+{
+    GameState state{};
+    run_benchmark(name, filter, [&]() {
+        state = prototype;
+        GameEvents events{update_game_state(state)};
+        do_not_optimize(events);
+        do_not_optimize(state);
+    });
+}
+
+static void bench_sim(const std::string &filter)
+{
+    GameState fresh{fresh_state()};
+    GameState bags{state_with_bags()};
+    GameState spawn{fresh};
+    spawn.spawn_timer = spawn.spawn_time_sec;
+
+    // the copy every tick benchmark pays for, to subtract from them
+    GameState state{};
+    run_benchmark("sim/copy_state", filter, [&]() {
+        state = fresh;
+        do_not_optimize(state);
+    });
+
+    bench_tick("sim/tick_empty", filter, fresh);
+    bench_tick("sim/tick_empty_with_bags", filter, bags);
+    bench_tick("sim/tick_gift", filter, state_facing(bags, TILE_GIFT));
+    bench_tick("sim/tick_house", filter, state_facing(bags, TILE_HOUSE));
+    bench_tick("sim/tick_house_without_bags", filter, state_facing(fresh, TILE_HOUSE));
+    bench_tick("sim/tick_bag", filter, state_facing(fresh, TILE_BAG));
+    bench_tick("sim/tick_spawn", filter, spawn);
+
+    // a whole game with the random player, from the first tick to game over
+    Rng game_rng{};
+    seed_rng(game_rng, 2);
+    Rng player_rng{};
+    seed_rng(player_rng, 3);
+    run_benchmark("sim/full_game", filter, [&]() {
+        state.rng = game_rng;
+        init_game_state(state);
+        while (!state.game_over)
+        {
+            random_player(state, player_rng);
+            update_game_state(state);
+        }
+        game_rng = state.rng;
+        do_not_optimize(state);
+    });
+}
+
+// the autopilot steering plus the tick it steers, game after game; the plan is
+// reused between iterations just like between ticks of a real game
+template <typename State>
+static void bench_autopilot_board(const std::string &name, const std::string &filter, State state)
+{
+    Autopilot<State::BOARD_ROWS, State::BOARD_COLS> autopilot{};
+    seed_rng(state.rng, 4);
+    init_game_state(state);
+    run_benchmark(name, filter, [&]() {
+        autopilot.steer(state);
+        GameEvents events{update_game_state(state)};
+        if (state.game_over)
+        {
+            init_game_state(state);
+        }
+        do_not_optimize(events);
+    });
+}
+
+static void bench_autopilot(const std::string &filter)
+{
+    bench_autopilot_board("autopilot/tick_8x8", filter, GameState{});
+    bench_autopilot_board("autopilot/tick_64x64", filter, BasicGameState<64, 64>{});
+    DynamicGameState large{};
+    large.board = Board<DYNAMIC_SIDE, DYNAMIC_SIDE>{256, 256};
+    bench_autopilot_board("autopilot/tick_256x256", filter, large);
+}
+
+static void bench_solver(const std::string &filter)
+{
+    GameState before{state_with_bags()};
+    GameState after{before};
+    update_game_state(after);
+    ZobristKeys<MAP_SIDE, MAP_SIDE> keys{before};
+    uint64_t hash{keys.hash(before)};
+
+    // the incremental update the search pays per node, against hashing from scratch
+    run_benchmark("solver/zobrist_step", filter, [&]() { do_not_optimize(keys.step(hash, before, after)); });
+    run_benchmark("solver/zobrist_hash", filter, [&]() { do_not_optimize(keys.hash(after)); });
+
+    // one tick of a solve on a single thread, playing on from one iteration to the next
+    Solver<MAP_SIDE, MAP_SIDE> solver{before, 1, 16, 6};
+    GameState state{fresh_state()};
+    run_benchmark("solver/tick_horizon_6", filter, [&]() {
+        state.santa_direction = solver.best_direction(state);
+        update_game_state(state);
+        if (state.game_over)
+        {
+            init_game_state(state);
+        }
+    });
+}
+
+// one swarm tick, bots included, for more and more agents on the same board;
+// the time per agent should stay flat
+static void bench_swarm(const std::string &filter)
+{
+    for (int agents : {256, 1024, 4096})
+    {
+        DynamicSwarmState state{};
+        state.board = Board<DYNAMIC_SIDE, DYNAMIC_SIDE>{256, 256};
+        Rng bot_rng{};
+        seed_rng(state.rng, 4, 0);
+        seed_rng(bot_rng, 4, 1);
+        init_swarm_state(state, agents);
+        run_benchmark(std::format("swarm/tick_{}_agents", agents), filter, [&]() {
+            steer_swarm_bots(state, bot_rng);
+            do_not_optimize(update_swarm_state(state));
+        });
+    }
+}
+
+static void bench_render(const std::string &filter)
+{
+    SDL2ExImageHandle sdl2ex_image_handle{};
+    SDL2ExSurface frame{LOGICAL_SCREEN_W, LOGICAL_SCREEN_H};
+    SDL2ExRenderer renderer{frame.Handle()};
+    SDL2ExTexture sprite_sheet{renderer, "assets/cozychristmas.png"};
+    SDL2ExRenderTarget board_cache{renderer, LOGICAL_SCREEN_W, LOGICAL_SCREEN_H};
+    SpriteBatch batch{renderer.Handle(), sprite_sheet.Handle()};
+
+    // a busy board: play until there is plenty on it, so every sprite path is drawn
+    GameState game_state{fresh_state()};
+    Rng player_rng{};
+    seed_rng(player_rng, 4);
+    GameSimulation simulation{game_state, nullptr, nullptr, nullptr};
+    simulation.start_game();
+    for (int i{}; i < 60; i++)
+    {
+        random_player(game_state, player_rng);
+        simulation.tick();
+    }
+    GameSnapshot snapshot{};
+    simulation.snapshot(snapshot);
+    GameScene game_scene{batch, board_cache.Handle()};
+    game_scene.show(snapshot);
+
+    run_benchmark("render/game_frame", filter, [&]() {
+        game_scene.render(0.5);
+        SDL_RenderFlush(renderer.Handle());
+    });
+    run_benchmark("render/game_frame_board_redraw", filter, [&]() {
+        game_scene.invalidate_board_cache();
+        game_scene.render(0.5);
+        SDL_RenderFlush(renderer.Handle());
+    });
+    run_benchmark("render/hash_frame", filter, [&]() {
+        uint64_t hash{hash_frame(frame.Handle())};
+        do_not_optimize(hash);
+    });
+}
+
+static void bench_assets(const std::string &filter)
+{
+    // sounds are decoded for a mixer that plays nowhere
+    SDL_SetHint("SDL_AUDIODRIVER", "dummy");
+    SDL2ExImageHandle sdl2ex_image_handle{};
+    SDL2ExMixerHandle sdl2ex_mixer_handle{};
+    SDL2ExSurface frame{LOGICAL_SCREEN_W, LOGICAL_SCREEN_H};
+    SDL2ExRenderer renderer{frame.Handle()};
+
+    run_benchmark("assets/cozychristmas.png", filter, [&]() { SDL2ExTexture texture{renderer, "assets/cozychristmas.png"}; });
+    run_benchmark("assets/theme.mp3", filter, [&]() { SDL2ExMusic music{"assets/theme.mp3"}; });
+    for (const char *file : {"assets/gift.wav", "assets/house.wav", "assets/hurt.wav", "assets/step.wav", "assets/spawn.wav"})
+    {
+        run_benchmark(file, filter, [&]() { SDL2ExChunk chunk{file}; });
+    }
+
+    // everything the game loads at startup, one after the other and on a thread each
+    AssetSource loose{"assets", ""}; // no pack name: the loose files even when a pack was built
+    run_benchmark("assets/all_serial", filter, [&]() {
+        SDL2ExSurface sprite_sheet{loose, "cozychristmas.png"};
+        SDL2ExMusic theme{loose, "theme.mp3"};
+        for (const char *name : {"gift.wav", "house.wav", "hurt.wav", "step.wav", "spawn.wav"})
+        {
+            SDL2ExChunk chunk{loose, name};
+        }
+    });
+    run_benchmark("assets/all_async", filter, [&]() {
+        PendingAsset<SDL2ExSurface> sprite_sheet{load_async<SDL2ExSurface>(loose, "cozychristmas.png")};
+        PendingAsset<SDL2ExMusic> theme{load_async<SDL2ExMusic>(loose, "theme.mp3")};
+        std::vector<PendingAsset<SDL2ExChunk>> chunks{};
+        for (const char *name : {"gift.wav", "house.wav", "hurt.wav", "step.wav", "spawn.wav"})
+        {
+            chunks.push_back(load_async<SDL2ExChunk>(loose, name));
+        }
+        sprite_sheet.get();
+        theme.get();
+        for (PendingAsset<SDL2ExChunk> &chunk : chunks)
+        {
+            chunk.get();
+        }
+    });
+
+    // the same assets from the pack, when it has been built with ./pack
+    if (std::filesystem::exists(std::string{"assets/"} + ASSET_PACK_FILE))
+    {
+        run_benchmark("assets/pack/open", filter, [&]() { AssetSource assets{"assets", ASSET_PACK_FILE}; });
+        AssetSource assets{"assets", ASSET_PACK_FILE};
+        run_benchmark("assets/pack/cozychristmas.png", filter, [&]() { SDL2ExTexture texture{renderer, assets, "cozychristmas.png"}; });
+        run_benchmark("assets/pack/theme.mp3", filter, [&]() { SDL2ExMusic music{assets, "theme.mp3"}; });
+        for (const char *name : {"gift.wav", "house.wav", "hurt.wav", "step.wav", "spawn.wav"})
+        {
+            run_benchmark(std::format("assets/pack/{}", name), filter, [&]() { SDL2ExChunk chunk{assets, name}; });
+        }
+    }
+}
+
+static int entry(int argc, char **argv)
+{
+    std::string filter{}; // only run benchmarks whose name contains this
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--filter" && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else
+        {
+            error(std::format("unknown argument '{}' (usage: bench [--filter TEXT])", arg));
+        }
+    }
+
+    bench_sim(filter);
+    bench_autopilot(filter);
+    bench_solver(filter);
+    bench_swarm(filter);
+    bench_render(filter);
+    bench_assets(filter);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return entry(argc, argv);
+    }
+    catch (const Error &error)
+    {
+        std::cerr << error.what() << "\n";
+    }
+
+    return 1;
+}
@@ -1,2 +1,10 @@
-# clang++ cozychristmas.cpp -o cozychristmas -std=c++23 -g -Weverything -Wno-padded -Wno-unsafe-buffer-usage -Wno-weak-vtables -Wno-c++98-compat -Wno-c++98-compat-pedantic -Wno-missing-noreturn -Wno-covered-switch-default -Werror -fsanitize=address -lstdc++exp $(sdl2-config --cflags --libs) -lSDL2_image -lSDL2_mixer
-clang++ cozychristmas.cpp -o cozychristmas -std=c++23 -g -Weverything -Wno-padded -Wno-unsafe-buffer-usage -Wno-weak-vtables -Wno-c++98-compat -Wno-c++98-compat-pedantic -Wno-missing-noreturn -Wno-covered-switch-default -Werror -lstdc++exp $(sdl2-config --cflags --libs) -lSDL2_image -lSDL2_mixer
+# clang++ cozychristmas.cpp -o cozychristmas -std=c++23 -g -pthread -Weverything -Wno-padded -Wno-unsafe-buffer-usage -Wno-weak-vtables -Wno-c++98-compat -Wno-c++98-compat-pedantic -Wno-missing-noreturn -Wno-covered-switch-default -Werror -fsanitize=address -lstdc++exp $(sdl2-config --cflags --libs) -lSDL2_image -lSDL2_mixer
+clang++ cozychristmas.cpp -o cozychristmas -std=c++23 -g -pthread -Weverything -Wno-padded -Wno-unsafe-buffer-usage -Wno-weak-vtables -Wno-c++98-compat -Wno-c++98-compat-pedantic -Wno-missing-noreturn -Wno-covered-switch-default -Werror -lstdc++exp $(sdl2-config --cflags --libs) -lSDL2_image -lSDL2_mixer
+# clang++ cozychristmas.cpp -o cozychristmas -std=c++23 -g -pthread -Weverything -Wno-padded -Wno-unsafe-buffer-usage -Wno-weak-vtables -Wno-c++98-compat -Wno-c++98-compat-pedantic -Wno-missing-noreturn -Wno-covered-switch-default -Werror -DCOZY_PROFILE -lstdc++exp $(sdl2-config --cflags --libs) -lSDL2_image -lSDL2_mixer
+clang++ headless.cpp -o headless -std=c++23 -O2 -pthread -Weverything -Wno-padded -Wno-unsafe-buffer-usage -Wno-weak-vtables -Wno-c++98-compat -Wno-c++98-compat-pedantic -Wno-missing-noreturn -Wno-covered-switch-default -Werror -lstdc++exp
+clang++ solve.cpp -o solve -std=c++23 -O2 -pthread -Weverything -Wno-padded -Wno-unsafe-buffer-usage -Wno-weak-vtables -Wno-c++98-compat -Wno-c++98-compat-pedantic -Wno-missing-noreturn -Wno-covered-switch-default -Werror -lstdc++exp
+clang++ fuzz.cpp -o fuzz -std=c++23 -O2 -pthread -Weverything -Wno-padded -Wno-unsafe-buffer-usage -Wno-weak-vtables -Wno-c++98-compat -Wno-c++98-compat-pedantic -Wno-missing-noreturn -Wno-covered-switch-default -Werror -lstdc++exp
+clang++ swarm.cpp -o swarm -std=c++23 -O2 -pthread -Weverything -Wno-padded -Wno-unsafe-buffer-usage -Wno-weak-vtables -Wno-c++98-compat -Wno-c++98-compat-pedantic -Wno-missing-noreturn -Wno-covered-switch-default -Werror -lstdc++exp
+clang++ replay.cpp -o replay -std=c++23 -O2 -pthread -Weverything -Wno-padded -Wno-unsafe-buffer-usage -Wno-weak-vtables -Wno-c++98-compat -Wno-c++98-compat-pedantic -Wno-missing-noreturn -Wno-covered-switch-default -Werror -lstdc++exp
+clang++ bench.cpp -o bench -std=c++23 -O2 -pthread -Weverything -Wno-padded -Wno-unsafe-buffer-usage -Wno-weak-vtables -Wno-c++98-compat -Wno-c++98-compat-pedantic -Wno-missing-noreturn -Wno-covered-switch-default -Werror -lstdc++exp $(sdl2-config --cflags --libs) -lSDL2_image -lSDL2_mixer
+clang++ pack.cpp -o pack -std=c++23 -O2 -Weverything -Wno-padded -Wno-unsafe-buffer-usage -Wno-weak-vtables -Wno-c++98-compat -Wno-c++98-compat-pedantic -Wno-missing-noreturn -Wno-covered-switch-default -Werror -lstdc++exp $(sdl2-config --cflags --libs) -lSDL2_image -lSDL2_mixer
@@ -1,342 +1,19 @@
-#include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
-#include <SDL2/SDL_mixer.h>
+#include "game.hpp"
 
 #include <vector>
 #include <algorithm>
+#include <bit>
 #include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <format>
 #include <random>
-#include <stacktrace>
-#include <stacktrace>
 #include <string>
-#include <stdexcept>
 
-constexpr int SCREEN_W{720};
-constexpr int SCREEN_H{720};
-constexpr int MAP_SIDE{8};
-constexpr int TILE_PIXEL_SIZE{14}; // TODO: find a better name
-constexpr int LOGICAL_SCREEN_W{MAP_SIDE * TILE_PIXEL_SIZE};
-constexpr int LOGICAL_SCREEN_H{MAP_SIDE * TILE_PIXEL_SIZE};
-constexpr double SPAWN_TIME_SEC_START{2.0};
-constexpr double SPAWN_TIME_DIFFICULTY_COEFFICIENT{0.01};
-constexpr double MIN_SPAWN_TIME_SEC{0.5};
-constexpr double SEC_PER_TICK{0.5};
-
-#define error(msg) \
-    throw Error { __FILE__, __LINE__, (msg) }
-
-#define unreachable() error("unreachable code path")
-
-class Error : public std::runtime_error
-{
-public:
-    Error(const char *file, int line, const std::string &message)
-        : std::runtime_error{std::format("{}({}): {}\n{}", file, line, message, std::to_string(std::stacktrace::current(1)))}
-    {
-    }
-};
-
-enum TileType : uint8_t
-{
-    TILE_EMPTY,
-    TILE_BAG,
-    TILE_GIFT,
-    TILE_HOUSE,
-};
-
-struct v2
-{
-    int row;
-    int col;
-};
-
-struct Tile
-{
-    constexpr Tile(TileType tile_type, int previous_row = 0, int previous_column = 0) noexcept
-        : type{tile_type}, prev_row{previous_row}, prev_col{previous_column}
-    {
-    }
-    constexpr Tile() noexcept
-        : Tile{TILE_EMPTY, -1, -1}
-    {
-    }
-
-    TileType type;
-    int prev_row; // Used only if type is TILE_BAG
-    int prev_col; // Used only if type is TILE_BAG
-};
-
-enum Direction : uint8_t
-{
-    DIRECTION_NORTH,
-    DIRECTION_SOUTH,
-    DIRECTION_WEST,
-    DIRECTION_EAST,
-};
-
-static int random_int(int lo, int hi) noexcept
-{
-    // TODO: there should be a cleaner solution here, but right now I don't care enough
-#pragma clang diagnostic push
-#pragma clang diagnostic ignored "-Wexit-time-destructors"
-    static std::random_device random_device{};
-#pragma clang diagnostic pop
-    static std::mt19937 generator{random_device()};
-    std::uniform_int_distribution<> distribution{lo, hi}; // from 'lo' included to 'hi' included
-    return distribution(generator);
-}
-
-#if 0
-static constexpr const char *direction_to_str(Direction direction) noexcept
-{
-    const char *str{""};
-    switch (direction)
-    {
-    case DIRECTION_NORTH:
-    {
-        str = "NORTH";
-    }
-    break;
-    case DIRECTION_SOUTH:
-    {
-        str = "SOUTH";
-    }
-    break;
-    case DIRECTION_WEST:
-    {
-        str = "WEST";
-    }
-    break;
-    case DIRECTION_EAST:
-    {
-        str = "EAST";
-    }
-    break;
-    default:
-    {
-    }
-    }
-    return str;
-}
-#endif
-
-static int mod(int a, int b)
-{
-    return (a % b + b) % b;
-}
-
-struct GameState
-{
-    Tile map[MAP_SIDE][MAP_SIDE]{};
-    Direction santa_direction;
-    v2 santa;
-    int num_bags;
-    v2 first_bag;
-    v2 last_bag;
-    bool game_over{true};
-    bool exit;
-    double spawn_time_sec{SPAWN_TIME_SEC_START};
-    double spawn_timer{};
-};
-
-struct SoundEffects
-{
-    Mix_Chunk *gift;
-    Mix_Chunk *house;
-    Mix_Chunk *hurt;
-    Mix_Chunk *step;
-    Mix_Chunk *spawn;
-};
-
-static void init_game_state(GameState &)
-{
-    // TODO: default initialize map, direction, santa, num_bags, first_bag, last_bag, spwan time sec, spwan timer
-}
-
-static void update_game_state(GameState &state, const SoundEffects &sfx)
-{
-    // save old santa position for later
-    v2 old_santa{state.santa};
-
-    // move santa
-    switch (state.santa_direction)
-    {
-    case DIRECTION_NORTH:
-    {
-        state.santa.row = mod(state.santa.row - 1, MAP_SIDE);
-    }
-    break;
-    case DIRECTION_SOUTH:
-    {
-        state.santa.row = mod(state.santa.row + 1, MAP_SIDE);
-    }
-    break;
-    case DIRECTION_WEST:
-    {
-        state.santa.col = mod(state.santa.col - 1, MAP_SIDE);
-    }
-    break;
-    case DIRECTION_EAST:
-    {
-        state.santa.col = mod(state.santa.col + 1, MAP_SIDE);
-    }
-    break;
-    default:
-    {
-        unreachable();
-    }
-    }
-
-    // run custom logic based on which tile santa is on
-    switch (state.map[state.santa.row][state.santa.col].type)
-    {
-    case TILE_EMPTY:
-    {
-        // if there are bags, employ logic to move them
-        if (state.num_bags > 0)
-        {
-            // make bag where santa was
-            state.map[old_santa.row][old_santa.col] = Tile{TILE_BAG};
-            // save old first bag location
-            v2 old_first_bag{state.first_bag};
-            // set new first bag location to where santa was
-            state.first_bag = old_santa;
-            // update previous bag pointer for old fisrst bag
-            state.map[old_first_bag.row][old_first_bag.col] = Tile{TILE_BAG, old_santa.row, old_santa.col};
-            // save previous to last bag position
-            v2 previous_to_last_bag{state.map[state.last_bag.row][state.last_bag.col].prev_row, state.map[state.last_bag.row][state.last_bag.col].prev_col};
-            // make empty tile where the last bag is
-            state.map[state.last_bag.row][state.last_bag.col] = Tile{TILE_EMPTY};
-            // update last bag position to previos to last bag position
-            state.last_bag = previous_to_last_bag;
-        }
-
-        // play step sound effect
-        Mix_PlayChannel(-1, sfx.step, 0);
-    }
-    break;
-    case TILE_GIFT:
-    {
-        // make gift tile empty where santa is
-        state.map[state.santa.row][state.santa.col] = Tile{TILE_EMPTY};
-        // spawn bag where santa was
-        state.map[old_santa.row][old_santa.col] = Tile{TILE_BAG};
-        if (state.num_bags <= 0)
-        {
-            // set first and last bag positions to where santa was
-            state.first_bag = old_santa;
-            state.last_bag = old_santa;
-        }
-        else // state.num_bags > 0
-        {
-            // update former first bag previous pointer with the new first bag
-            state.map[state.first_bag.row][state.first_bag.col] = Tile{TILE_BAG, old_santa.row, old_santa.col};
-        }
-        // update new first bag position
-        state.first_bag = old_santa;
-        // increase number of bags
-        state.num_bags++;
-
-        // play gift sound effect
-        Mix_PlayChannel(-1, sfx.gift, 0);
-    }
-    break;
-    case TILE_BAG:
-    {
-        state.game_over = true;
-    }
-    break;
-    case TILE_HOUSE:
-    {
-        if (state.num_bags <= 0)
-        {
-            state.game_over = true;
-
-            // play hurt sound effect
-            Mix_PlayChannel(-1, sfx.hurt, 0);
-        }
-        else // state.num_bags > 0
-        {
-            // make house tile empty where santa is
-            state.map[state.santa.row][state.santa.col] = Tile{TILE_EMPTY};
-            // save last bag tile
-            Tile saved = state.map[state.last_bag.row][state.last_bag.col];
-            // remove last bag tile
-            state.map[state.last_bag.row][state.last_bag.col] = Tile{TILE_EMPTY};
-            if (state.num_bags > 1)
-            {
-                // update last bag
-                state.last_bag = v2{saved.prev_row, saved.prev_col};
-                // spawn bag where santa was
-                state.map[old_santa.row][old_santa.col] = Tile{TILE_BAG};
-                // save former first bag
-                v2 old_first_bag = state.first_bag;
-                // update new first bag position
-                state.first_bag = old_santa;
-                // update former first bag previous pointer with the new first bag
-                state.map[old_first_bag.row][old_first_bag.col] = Tile{TILE_BAG, state.first_bag.row, state.first_bag.col};
-                // save previous to last bag
-                Tile last_bag{state.map[state.last_bag.row][state.last_bag.col]};
-                // remove last bag tile
-                state.map[state.last_bag.row][state.last_bag.col] = Tile{TILE_EMPTY};
-                // update last bag position
-                state.last_bag = v2{last_bag.prev_row, last_bag.prev_col};
-            }
-            // decrease number of bags
-            state.num_bags--;
-
-            // play house sound effect
-            Mix_PlayChannel(-1, sfx.house, 0);
-        }
-    }
-    break;
-    default:
-    {
-        unreachable();
-    }
-    }
-
-    // when spawn timer sets off, either spawn a gift or a house
-    if (state.spawn_timer >= state.spawn_time_sec)
-    {
-        // spawning logic
-        {
-            std::vector<v2> empty_tiles{};
-            for (int row{}; row < MAP_SIDE; row++)
-            {
-                for (int col{}; col < MAP_SIDE; col++)
-                {
-                    bool is_santa_on_tile{state.santa.row == row && state.santa.col == col};
-                    if (state.map[row][col].type == TILE_EMPTY && !is_santa_on_tile)
-                    {
-                        empty_tiles.emplace_back(row, col);
-                    }
-                }
-            }
-
-            if (empty_tiles.size() > 0)
-            {
-                // spawn either a gift or a house randomly
-                int size{static_cast<int>(empty_tiles.size())};
-                size_t idx{static_cast<size_t>(random_int(0, size - 1))};
-                v2 random_tile{empty_tiles[idx]};
-                state.map[random_tile.row][random_tile.col] = Tile{random_int(1, 100) <= 50 ? TILE_GIFT : TILE_HOUSE};
-
-                // play spawn sound
-                Mix_PlayChannel(-1, sfx.spawn, 0);
-            }
-        }
-
-        // make spawn time a little shorter (to make game harder)
-        state.spawn_time_sec -= SPAWN_TIME_DIFFICULTY_COEFFICIENT * state.spawn_time_sec;
-        // make sure spawn time doesn't go below the fixed minimum
-        state.spawn_time_sec = std::max(state.spawn_time_sec, MIN_SPAWN_TIME_SEC);
-        // reset timer
-        state.spawn_timer = 0.0;
-    }
-}
+constexpr int LOADING_FRAME_MS{16}; // how often the loading screen checks on the decoding threads
 
 #if 0
 static void entry()
@@ -359,7 +36,7 @@ static void entry()
                     }
                     else // otherwise, render the tile
                     {
-                        switch (game_state.map[i][j].type)
+                        switch (tile_at(game_state.board, v2{i, j}))
                         {
                         case TILE_EMPTY:
                             std::cout << '.';
@@ -384,8 +61,8 @@ static void entry()
             std::cout << "direction: " << direction_to_str(game_state.santa_direction) << '\n';
             std::cout << "Santa: " << game_state.santa.row << ',' << game_state.santa.col << '\n';
             std::cout << "Bags: " << game_state.num_bags << '\n';
-            std::cout << "First bag: " << game_state.first_bag.row << ',' << game_state.first_bag.col << '\n';
-            std::cout << "Last bag: " << game_state.last_bag.row << ',' << game_state.last_bag.col << '\n';
+            std::cout << "First bag: " << first_bag(game_state).row << ',' << first_bag(game_state).col << '\n';
+            std::cout << "Last bag: " << last_bag(game_state).row << ',' << last_bag(game_state).col << '\n';
         }
 
         // get input for current tick
@@ -433,524 +110,277 @@ static void entry()
 }
 #endif
 
-class SDL2ExHandle
+// what rendering cost over the whole run, printed on exit
+struct FrameStats
 {
-public:
-    SDL2ExHandle()
-    {
-        int res{SDL_Init(SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS)};
-        if (res < 0)
-        {
-            error(std::format("failed to initialize SDL2: {}", SDL_GetError()));
-        }
-    }
-    ~SDL2ExHandle() noexcept
-    {
-        SDL_Quit();
-    }
-    SDL2ExHandle(const SDL2ExHandle &) noexcept = delete;
-    SDL2ExHandle(SDL2ExHandle &&) noexcept = delete;
-    SDL2ExHandle &operator=(const SDL2ExHandle &) noexcept = delete;
-    SDL2ExHandle &operator=(SDL2ExHandle &&) noexcept = delete;
+    int64_t frames;
+    int64_t draw_calls;
+    double total_sec;
+    double max_sec;
 };
 
-class SDL2ExImageHandle
+// cpu time the process spent over some stretch of wall time
+struct CpuUsage
 {
-public:
-    SDL2ExImageHandle()
-    {
-        int result{IMG_Init(IMG_INIT_PNG)};
-        if (!(result & IMG_INIT_PNG))
-        {
-            error(std::format("failed to initialize SDL2 image: {}", IMG_GetError()));
-        }
-    }
-    ~SDL2ExImageHandle() noexcept
-    {
-        IMG_Quit();
-    }
-    SDL2ExImageHandle(const SDL2ExImageHandle &) noexcept = delete;
-    SDL2ExImageHandle(SDL2ExImageHandle &&) noexcept = delete;
-    SDL2ExImageHandle &operator=(const SDL2ExImageHandle &) noexcept = delete;
-    SDL2ExImageHandle &operator=(SDL2ExImageHandle &&) noexcept = delete;
+    double wall_sec;
+    double cpu_sec;
 };
 
-class SDL2ExMixerHandle
+static double process_cpu_sec() noexcept
 {
-public:
-    SDL2ExMixerHandle()
-    {
-        // Initialize SDL_mixer for Audio (44.1khz, default format, 2 channels, 2048 chunk size)
-        int res{Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048)};
-        if (res < 0)
-        {
-            error(std::format("failed to initialize SDL2 mixer: {}", Mix_GetError()));
-        }
-    }
-    ~SDL2ExMixerHandle() noexcept
-    {
-        Mix_Quit();
-    }
-    SDL2ExMixerHandle(const SDL2ExMixerHandle &) noexcept = delete;
-    SDL2ExMixerHandle(SDL2ExMixerHandle &&) noexcept = delete;
-    SDL2ExMixerHandle &operator=(const SDL2ExMixerHandle &) noexcept = delete;
-    SDL2ExMixerHandle &operator=(SDL2ExMixerHandle &&) noexcept = delete;
-};
+    return static_cast<double>(std::clock()) / static_cast<double>(CLOCKS_PER_SEC);
+}
 
-class SDL2ExWindow
+// a progress bar in the middle of the screen, while assets are still decoding
+static void render_loading(SDL_Renderer *renderer, int loaded, int total)
 {
-public:
-    SDL2ExWindow() : handle{}
-    {
-        handle = SDL_CreateWindow("Cozy Christmas",
-                                  SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-                                  SCREEN_W, SCREEN_H,
-                                  SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_MAXIMIZED);
-        if (!handle)
-        {
-            error(std::format("failed to create SDL2 window: {}", SDL_GetError()));
-        }
-    }
-    ~SDL2ExWindow() noexcept
-    {
-        SDL_DestroyWindow(handle);
-    }
-    SDL2ExWindow(const SDL2ExWindow &) noexcept = delete;
-    SDL2ExWindow(SDL2ExWindow &&) noexcept = delete;
-    SDL2ExWindow &operator=(const SDL2ExWindow &) noexcept = delete;
-    SDL2ExWindow &operator=(SDL2ExWindow &&) noexcept = delete;
-
-public:
-    constexpr SDL_Window *Handle() const noexcept { return handle; }
-
-private:
-    SDL_Window *handle;
-};
+    constexpr int bar_w{LOGICAL_SCREEN_W / 2};
+    constexpr int bar_h{TILE_PIXEL_SIZE / 2};
+    SDL_Rect bar{(LOGICAL_SCREEN_W - bar_w) / 2, (LOGICAL_SCREEN_H - bar_h) / 2, bar_w, bar_h};
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+    SDL_SetRenderDrawColor(renderer, 110, 110, 110, 255);
+    SDL_RenderFillRect(renderer, &bar);
+    bar.w = bar_w * loaded / total;
+    SDL_SetRenderDrawColor(renderer, 240, 240, 240, 255);
+    SDL_RenderFillRect(renderer, &bar);
+}
 
-class SDL2ExRenderer
+#if defined(COZY_PROFILE)
+// one row per phase across the top of the screen: p99 in grey under p50 in white,
+// a full row being a 60 hz frame
+static void render_profile_overlay(SpriteBatch &batch, const Profiler &profiler)
 {
-public:
-    SDL2ExRenderer(SDL_Window *window) : handle{}
-    {
-        // Create Renderer (Hardware accelerated and VSync enabled)
-        handle = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-        if (!handle)
-        {
-            error(std::format("failed to create SDL2 renderer: {}", SDL_GetError()));
-        }
-    }
-    ~SDL2ExRenderer() noexcept
+    constexpr int row_h{3};
+    constexpr double full_row_ns{1e9 / 60.0};
+    batch.fill_rect(SDL_Rect{0, 0, LOGICAL_SCREEN_W, PROFILE_PHASE_COUNT * (row_h + 1) + 1}, 0, 0, 0);
+    for (int i{}; i < PROFILE_PHASE_COUNT; i++)
     {
-        SDL_DestroyRenderer(handle);
+        const Histogram &phase{profiler.phases[i]};
+        auto bar_w{[](uint64_t ns) { return static_cast<int>(std::min(1.0, static_cast<double>(ns) / full_row_ns) * LOGICAL_SCREEN_W) + 1; }};
+        int y{1 + i * (row_h + 1)};
+        batch.fill_rect(SDL_Rect{0, y, bar_w(histogram_percentile(phase, 0.99)), row_h}, 110, 110, 110);
+        batch.fill_rect(SDL_Rect{0, y, bar_w(histogram_percentile(phase, 0.5)), row_h}, 240, 240, 240);
     }
-    SDL2ExRenderer(const SDL2ExRenderer &) noexcept = delete;
-    SDL2ExRenderer(SDL2ExRenderer &&) noexcept = delete;
-    SDL2ExRenderer &operator=(const SDL2ExRenderer &) noexcept = delete;
-    SDL2ExRenderer &operator=(SDL2ExRenderer &&) noexcept = delete;
-
-public:
-    constexpr SDL_Renderer *Handle() const noexcept { return handle; }
-
-private:
-    SDL_Renderer *handle;
-};
+}
 
-class SDL2ExSurface
+static std::string profile_title(const Profiler &profiler)
 {
-public:
-    SDL2ExSurface(const char *file) : handle{}
+    std::string title{"p50/p99 ms:"};
+    for (int i{}; i < PROFILE_PHASE_COUNT; i++)
     {
-        handle = IMG_Load(file);
-        if (!handle)
-        {
-            error(std::format("failed to create SDL2 surface for file '{}': {}", file, IMG_GetError()));
-        }
+        const Histogram &phase{profiler.phases[i]};
+        title += std::format(" {} {:.2f}/{:.2f}", profile_phase_name(static_cast<ProfilePhase>(i)), static_cast<double>(histogram_percentile(phase, 0.5)) / 1e6, static_cast<double>(histogram_percentile(phase, 0.99)) / 1e6);
     }
-    ~SDL2ExSurface() noexcept
+    return title;
+}
+#endif
+
+// write out the replays the simulation finished, named after their start rng, and forget them
+static void save_replays(const std::string &record_dir, std::vector<FinishedReplay> &replays)
+{
+    for (const FinishedReplay &replay : replays)
     {
-        SDL_FreeSurface(handle);
+        write_file(std::format("{}/{:016x}{}", record_dir, replay.start_rng_state, REPLAY_EXTENSION), replay.bytes);
     }
-    SDL2ExSurface(const SDL2ExSurface &) noexcept = delete;
-    SDL2ExSurface(SDL2ExSurface &&) noexcept = delete;
-    SDL2ExSurface &operator=(const SDL2ExSurface &) noexcept = delete;
-    SDL2ExSurface &operator=(SDL2ExSurface &&) noexcept = delete;
-
-public:
-    constexpr SDL_Surface *Handle() const noexcept { return handle; }
-
-private:
-    SDL_Surface *handle;
-};
+    replays.clear();
+}
 
-class SDL2ExTexture
+// render recorded games offscreen with the software renderer and compare every
+// frame against the golden hashes stored next to each replay ('<replay>.frames',
+// one hex hash per line); with 'write' the golden hashes are (re)written instead.
+// Needs no display, gpu or audio device, so it runs on ci
+static int check_frames(const std::string &dir, bool write)
 {
-public:
-    SDL2ExTexture(const SDL2ExRenderer &renderer, const char *file) : handle{}
+    std::vector<std::string> paths{};
+    for (const std::filesystem::directory_entry &file : std::filesystem::recursive_directory_iterator{dir})
     {
-        SDL2ExSurface tmp{file};
-        handle = SDL_CreateTextureFromSurface(renderer.Handle(), tmp.Handle());
-        if (!handle)
+        if (file.is_regular_file() && file.path().extension() == REPLAY_EXTENSION)
         {
-            error(std::format("failed to create SDL2 texture for file '{}': {}", file, SDL_GetError()));
+            paths.push_back(file.path().string());
         }
     }
-    ~SDL2ExTexture() noexcept
-    {
-        SDL_DestroyTexture(handle);
-    }
-    SDL2ExTexture(const SDL2ExTexture &) noexcept = delete;
-    SDL2ExTexture(SDL2ExTexture &&) noexcept = delete;
-    SDL2ExTexture &operator=(const SDL2ExTexture &) noexcept = delete;
-    SDL2ExTexture &operator=(SDL2ExTexture &&) noexcept = delete;
+    std::sort(paths.begin(), paths.end());
 
-public:
-    constexpr SDL_Texture *Handle() const noexcept { return handle; }
-
-private:
-    SDL_Texture *handle;
-};
+    SDL2ExImageHandle sdl2ex_image_handle{};
+    SDL2ExSurface frame{LOGICAL_SCREEN_W, LOGICAL_SCREEN_H};
+    SDL2ExRenderer renderer{frame.Handle()};
+    SDL2ExTexture sprite_sheet{renderer, "assets/cozychristmas.png"};
+    SDL2ExRenderTarget board_cache{renderer, LOGICAL_SCREEN_W, LOGICAL_SCREEN_H};
+    SpriteBatch batch{renderer.Handle(), sprite_sheet.Handle()};
 
-class SDL2ExMusic
-{
-public:
-    SDL2ExMusic(const char *file) : handle{}
-    {
-        handle = Mix_LoadMUS(file);
-        if (!handle)
+    // the simulation runs in step with the frames here, no thread needed
+    GameState game_state{};
+    GameSimulation simulation{game_state, nullptr, nullptr, nullptr};
+    GameSnapshot snapshot{};
+    GameScene game_scene{batch, board_cache.Handle()};
+    GameOverScene game_over_scene{batch};
+
+    int failed{};
+    int64_t frames{};
+    Uint64 start{SDL_GetPerformanceCounter()};
+    for (const std::string &path : paths)
+    {
+        std::vector<uint8_t> bytes{read_file(path)};
+        Replay replay{parse_replay(bytes.data(), bytes.size())};
+        if (replay.rows != MAP_SIDE || replay.cols != MAP_SIDE)
+        {
+            failed++;
+            std::cout << std::format("FAIL {}: {}x{} board, the game renders {}x{}\n", path, replay.rows, replay.cols, MAP_SIDE, MAP_SIDE);
+            continue;
+        }
+
+        // every tick is drawn twice: where it landed and halfway to the next one
+        std::vector<uint64_t> hashes{};
+        auto render_frame{[&](IScene &scene, double alpha) {
+            scene.render(alpha);
+            SDL_RenderFlush(renderer.Handle());
+            hashes.push_back(hash_frame(frame.Handle()));
+        }};
+        game_state.rng = replay.rng;
+        simulation.start_game();
+        simulation.snapshot(snapshot);
+        game_scene.show(snapshot);
+        game_scene.invalidate_board_cache();
+        render_frame(game_scene, 0.0);
+        for (Direction direction : replay.directions)
+        {
+            game_state.santa_direction = direction;
+            simulation.tick();
+            simulation.snapshot(snapshot);
+            game_scene.show(snapshot);
+            render_frame(game_scene, 0.0);
+            render_frame(game_scene, 0.5);
+        }
+        if (game_state.game_over)
         {
-            error(std::format("filed to load SDL2 music for file '{}': {}", file, Mix_GetError()));
+            render_frame(game_over_scene, 0.0);
         }
-    }
-    ~SDL2ExMusic() noexcept
-    {
-        Mix_FreeMusic(handle);
-    }
-    SDL2ExMusic(const SDL2ExMusic &) noexcept = delete;
-    SDL2ExMusic(SDL2ExMusic &&) noexcept = delete;
-    SDL2ExMusic &operator=(const SDL2ExMusic &) noexcept = delete;
-    SDL2ExMusic &operator=(SDL2ExMusic &&) noexcept = delete;
+        frames += static_cast<int64_t>(hashes.size());
 
-public:
-    constexpr Mix_Music *Handle() const noexcept { return handle; }
-
-private:
-    Mix_Music *handle;
-};
+        std::string golden_path{path + ".frames"};
+        if (write)
+        {
+            std::string text{};
+            for (uint64_t hash : hashes)
+            {
+                text += std::format("{:016x}\n", hash);
+            }
+            write_file(golden_path, std::vector<uint8_t>(text.begin(), text.end()));
+            continue;
+        }
 
-class SDL2ExChunk
-{
-public:
-    SDL2ExChunk(const char *file) : handle{}
-    {
-        handle = Mix_LoadWAV(file);
-        if (!handle)
+        std::ifstream golden{golden_path};
+        if (!golden)
         {
-            error(std::format("failed to load SDL2 chunk for file '{}': {}", file, Mix_GetError()));
+            failed++;
+            std::cout << std::format("FAIL {}: no golden hashes (run with --write-frames)\n", path);
+            continue;
+        }
+        std::string line{};
+        size_t mismatch{};
+        while (mismatch < hashes.size() && std::getline(golden, line) && std::strtoull(line.c_str(), nullptr, 16) == hashes[mismatch])
+        {
+            mismatch++;
+        }
+        bool is_longer{static_cast<bool>(std::getline(golden, line))};
+        if (hash_game_state(game_state) != replay.final_hash)
+        {
+            failed++;
+            std::cout << std::format("FAIL {}: final state hash does not match\n", path);
+        }
+        else if (mismatch != hashes.size() || is_longer)
+        {
+            failed++;
+            std::cout << std::format("FAIL {}: frame {} of {} differs\n", path, mismatch, hashes.size());
         }
     }
-    ~SDL2ExChunk() noexcept
-    {
-        Mix_FreeChunk(handle);
-    }
-    SDL2ExChunk(const SDL2ExChunk &) noexcept = delete;
-    SDL2ExChunk(SDL2ExChunk &&) noexcept = delete;
-    SDL2ExChunk &operator=(const SDL2ExChunk &) noexcept = delete;
-    SDL2ExChunk &operator=(SDL2ExChunk &&) noexcept = delete;
+    double elapsed_sec{static_cast<double>(SDL_GetPerformanceCounter() - start) / static_cast<double>(SDL_GetPerformanceFrequency())};
 
-public:
-    constexpr Mix_Chunk *Handle() const noexcept { return handle; }
+    std::cout << std::format("replays: {} ({} failed)\n", paths.size(), failed);
+    std::cout << std::format("frames: {}\n", frames);
+    std::cout << std::format("elapsed: {:.3f} s\n", elapsed_sec);
+    std::cout << std::format("frames/sec: {:.0f}\n", static_cast<double>(frames) / elapsed_sec);
 
-private:
-    Mix_Chunk *handle;
-};
+    return failed == 0 ? 0 : 1;
+}
 
-class IScene
+static int
+entry(int argc, char **argv)
 {
-public:
-    virtual void update(double dt_sec) = 0;
-    virtual void render() = 0;
-
-public:
-    virtual ~IScene() noexcept = default;
-};
+    // ------------------------------------------------------------------------
+    // command line
+    // ------------------------------------------------------------------------
 
-class GameOverScene : public IScene
-{
-public:
-    GameOverScene(GameState &game_state, SDL_Renderer *renderer, SDL_Texture *sprite_sheet) noexcept
-        : m_game_state{game_state}, m_renderer{renderer}, m_sprite_sheet{sprite_sheet} {}
-    ~GameOverScene() noexcept override = default;
-    GameOverScene(const GameOverScene &) noexcept = delete;
-    GameOverScene(GameOverScene &&) noexcept = delete;
-    GameOverScene &operator=(const GameOverScene &) noexcept = delete;
-    GameOverScene &operator=(GameOverScene &&) noexcept = delete;
-
-public:
-    void update(double /*dt_sec*/) override
-    {
-    }
-    void render() override
+    // the same seed and the same inputs play the same game
+    uint64_t seed{std::random_device{}()};
+    std::string record_dir{}; // where to save a replay of every game, if anywhere
+    std::string frames_dir{}; // replays to render headless and check against their golden frames
+    bool write_frames{};
+    bool use_autopilot{}; // play by itself, game after game, for soak tests
+    for (int i{1}; i < argc; i++)
     {
-        // clear the screen to black
-        SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 255);
-        SDL_RenderClear(m_renderer);
-
-        // draw background
+        std::string arg{argv[i]};
+        if (arg == "--seed" && i + 1 < argc)
         {
-            // set background to palette dark green (bounding boxes)
-            SDL_SetRenderDrawColor(m_renderer, 31, 50, 36, 255);
-            // define the area to draw
-            SDL_Rect myRect{0, 0, LOGICAL_SCREEN_W, LOGICAL_SCREEN_H};
-            // draw it
-            SDL_RenderFillRect(m_renderer, &myRect);
+            seed = std::strtoull(argv[++i], nullptr, 10);
         }
-
-        constexpr int cozy_christmas_w{109};
-        constexpr int cozy_christmas_h{43};
-
-        SDL_Rect dst_rect{};
-        dst_rect.x = (LOGICAL_SCREEN_W / 2) - (cozy_christmas_w / 2);
-        dst_rect.y = (LOGICAL_SCREEN_H / 2) - (cozy_christmas_h / 2);
-        dst_rect.w = cozy_christmas_w;
-        dst_rect.h = cozy_christmas_h;
-
-        SDL_Rect src_rect{};
-        src_rect.x = 8;
-        src_rect.y = 33;
-        src_rect.w = cozy_christmas_w;
-        src_rect.h = cozy_christmas_h;
-
-        SDL_RenderCopy(m_renderer, m_sprite_sheet, &src_rect, &dst_rect);
-    }
-
-private:
-    [[maybe_unused]] GameState &m_game_state; // TODO: remove [[maybe_unused]]
-    SDL_Renderer *m_renderer;
-    SDL_Texture *m_sprite_sheet;
-};
-
-class GameScene : public IScene
-{
-public:
-    GameScene(GameState &game_state, SDL_Renderer *renderer, SDL_Texture *sprite_sheet, const SoundEffects &sfx) noexcept
-        : m_game_state{game_state}, m_renderer{renderer}, m_sprite_sheet{sprite_sheet}, m_sfx{sfx}, m_tick_timer{SEC_PER_TICK}
-    {
-    }
-    ~GameScene() noexcept override = default;
-    GameScene(const GameScene &) noexcept = delete;
-    GameScene(GameScene &&) noexcept = delete;
-    GameScene operator=(const GameScene &) noexcept = delete;
-    GameScene operator=(GameScene &&) noexcept = delete;
-
-public:
-    void update(double dt_sec) override
-    {
-        // update santa direction based on WASD or arrow keys
+        else if (arg == "--record" && i + 1 < argc)
         {
-            const Uint8 *keyboard{SDL_GetKeyboardState(nullptr)};
-            if (keyboard[SDL_SCANCODE_W] || keyboard[SDL_SCANCODE_UP])
-            {
-                // santa cannot go in the opposite direction while carrying bags, otherwise he would die
-                if (!(m_game_state.santa_direction == DIRECTION_SOUTH && m_game_state.num_bags > 0))
-                {
-                    m_game_state.santa_direction = DIRECTION_NORTH;
-                }
-            }
-            if (keyboard[SDL_SCANCODE_S] || keyboard[SDL_SCANCODE_DOWN])
-            {
-                // santa cannot go in the opposite direction while carrying bags, otherwise he would die
-                if (!(m_game_state.santa_direction == DIRECTION_NORTH && m_game_state.num_bags > 0))
-                {
-                    m_game_state.santa_direction = DIRECTION_SOUTH;
-                }
-            }
-            if (keyboard[SDL_SCANCODE_A] || keyboard[SDL_SCANCODE_LEFT])
-            {
-                // santa cannot go in the opposite direction while carrying bags, otherwise he would die
-                if (!(m_game_state.santa_direction == DIRECTION_EAST && m_game_state.num_bags > 0))
-                {
-                    m_game_state.santa_direction = DIRECTION_WEST;
-                }
-            }
-            if (keyboard[SDL_SCANCODE_D] || keyboard[SDL_SCANCODE_RIGHT])
-            {
-                // santa cannot go in the opposite direction while carrying bags, otherwise he would die
-                if (!(m_game_state.santa_direction == DIRECTION_WEST && m_game_state.num_bags > 0))
-                {
-                    m_game_state.santa_direction = DIRECTION_EAST;
-                }
-            }
+            record_dir = argv[++i];
         }
-
-        // update and render game state
-        if (m_tick_timer >= SEC_PER_TICK)
+        else if (arg == "--check-frames" && i + 1 < argc)
         {
-            // update game
-            update_game_state(m_game_state, m_sfx);
-
-            // reset timer
-            m_tick_timer = 0.0;
+            frames_dir = argv[++i];
         }
-
-        // update spawn timer
-        m_game_state.spawn_timer += dt_sec;
-
-        // update tick timer
-        m_tick_timer += dt_sec;
-    }
-    void render() override
-    {
-        // clear the screen to black
-        SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 255);
-        SDL_RenderClear(m_renderer);
-
-        // draw background
+        else if (arg == "--write-frames")
         {
-            // set background to palette dark green (bounding boxes)
-            SDL_SetRenderDrawColor(m_renderer, 31, 50, 36, 255);
-            // define the area to draw
-            SDL_Rect myRect{0, 0, LOGICAL_SCREEN_W, LOGICAL_SCREEN_H};
-            // draw it
-            SDL_RenderFillRect(m_renderer, &myRect);
+            write_frames = true;
         }
-
-        // render map
-        for (int row{}; row < MAP_SIDE; row++)
+        else if (arg == "--autopilot")
         {
-            for (int col{}; col < MAP_SIDE; col++)
-            {
-                SDL_Rect dst_rect{};
-                dst_rect.x = col * TILE_PIXEL_SIZE;
-                dst_rect.y = row * TILE_PIXEL_SIZE;
-                dst_rect.w = TILE_PIXEL_SIZE;
-                dst_rect.h = TILE_PIXEL_SIZE;
-
-                SDL_Rect src_rect{};
-                src_rect.w = TILE_PIXEL_SIZE;
-                src_rect.h = TILE_PIXEL_SIZE;
-
-                bool should_render{true};
-
-                switch (m_game_state.map[row][col].type)
-                {
-                case TILE_GIFT:
-                {
-                    src_rect.x = 1;
-                    src_rect.y = 16;
-                }
-                break;
-                case TILE_BAG:
-                {
-                    src_rect.x = 16;
-                    src_rect.y = 1;
-                }
-                break;
-                case TILE_HOUSE:
-                {
-                    src_rect.x = 16;
-                    src_rect.y = 16;
-                }
-                break;
-                case TILE_EMPTY:
-                default:
-                {
-                    should_render = false;
-                }
-                break;
-                }
-
-                if (should_render)
-                {
-                    if (m_game_state.santa_direction == DIRECTION_EAST &&
-                        m_game_state.map[row][col].type == TILE_BAG)
-                    {
-                        SDL_RenderCopyEx(
-                            m_renderer,
-                            m_sprite_sheet,
-                            &src_rect,
-                            &dst_rect,
-                            0.0,
-                            NULL,
-                            SDL_FLIP_HORIZONTAL);
-                    }
-                    else
-                    {
-                        SDL_RenderCopy(m_renderer, m_sprite_sheet, &src_rect, &dst_rect);
-                    }
-                }
-            }
+            use_autopilot = true;
         }
-
-        // render santa
+        else
         {
-            SDL_Rect dst_rect{};
-            dst_rect.x = m_game_state.santa.col * TILE_PIXEL_SIZE;
-            dst_rect.y = m_game_state.santa.row * TILE_PIXEL_SIZE;
-            dst_rect.w = TILE_PIXEL_SIZE;
-            dst_rect.h = TILE_PIXEL_SIZE;
-
-            SDL_Rect src_rect{};
-            src_rect.x = 1;
-            src_rect.y = 1;
-            src_rect.w = TILE_PIXEL_SIZE;
-            src_rect.h = TILE_PIXEL_SIZE;
-
-            if (m_game_state.santa_direction == DIRECTION_EAST)
-            {
-                SDL_RenderCopyEx(
-                    m_renderer,
-                    m_sprite_sheet,
-                    &src_rect,
-                    &dst_rect,
-                    0.0,
-                    NULL,
-                    SDL_FLIP_HORIZONTAL);
-            }
-            else
-            {
-                SDL_RenderCopy(m_renderer, m_sprite_sheet, &src_rect, &dst_rect);
-            }
+            error(std::format("unknown argument '{}' (usage: cozychristmas [--seed N] [--record DIR] [--autopilot] [--check-frames DIR [--write-frames]])", arg));
         }
-
-        // TODO: render ui
     }
+    if (!frames_dir.empty())
+    {
+        return check_frames(frames_dir, write_frames);
+    }
+    std::cout << std::format("seed: {}\n", seed);
 
-private:
-    GameState &m_game_state;
-    SDL_Renderer *m_renderer;
-    SDL_Texture *m_sprite_sheet;
-    const SoundEffects &m_sfx;
-    double m_tick_timer;
-};
-
-static int
-entry()
-{
     // ------------------------------------------------------------------------
     // sdl2 initialization
     // ------------------------------------------------------------------------
 
+    Uint64 startup_start{SDL_GetPerformanceCounter()};
     SDL2ExHandle sdl2ex_handle{};
     SDL2ExImageHandle sdl2ex_image_handle{};
-    SDL2ExMixerHandle sdl2ex_mixer_handle{};
-    SDL2ExWindow window{};
-    SDL2ExRenderer renderer{window.Handle()};
 
     // ------------------------------------------------------------------------
     // asset loading
     // ------------------------------------------------------------------------
 
-    SDL2ExTexture sprite_sheet{renderer, "assets/cozychristmas.png"};
-    SDL2ExMusic theme{"assets/theme.mp3"};
-    SDL2ExChunk gift{"assets/gift.wav"};
-    SDL2ExChunk house{"assets/house.wav"};
-    SDL2ExChunk hurt{"assets/hurt.wav"};
-    SDL2ExChunk step{"assets/step.wav"};
-    SDL2ExChunk spawn{"assets/spawn.wav"};
+    // from the pack built by the packer if there is one (it stays mapped while the
+    // assets live), from the loose files otherwise. Everything decodes on worker
+    // threads while the window and renderer are created; the image only needs
+    // sdl_image so it starts first, the sounds are converted to the mixer's format
+    // so they wait for it to be open
+    AssetSource assets{"assets", ASSET_PACK_FILE};
+    PendingAsset<SDL2ExSurface> pending_sprite_sheet{load_async<SDL2ExSurface>(assets, "cozychristmas.png")};
+    SDL2ExMixerHandle sdl2ex_mixer_handle{};
+    PendingAsset<SDL2ExMusic> pending_theme{load_async<SDL2ExMusic>(assets, "theme.mp3")};
+    PendingAsset<SDL2ExChunk> pending_gift{load_async<SDL2ExChunk>(assets, "gift.wav")};
+    PendingAsset<SDL2ExChunk> pending_house{load_async<SDL2ExChunk>(assets, "house.wav")};
+    PendingAsset<SDL2ExChunk> pending_hurt{load_async<SDL2ExChunk>(assets, "hurt.wav")};
+    PendingAsset<SDL2ExChunk> pending_step{load_async<SDL2ExChunk>(assets, "step.wav")};
+    PendingAsset<SDL2ExChunk> pending_spawn{load_async<SDL2ExChunk>(assets, "spawn.wav")};
 
-    // ------------------------------------------------------------------------
-    // main loop
-    // ------------------------------------------------------------------------
+    SDL2ExWindow window{};
+    SDL2ExRenderer renderer{window.Handle()};
 
     // set logical screen size
     {
@@ -961,30 +391,110 @@ entry()
         }
     }
 
+    // show how far decoding got for as long as it is still going
+    auto count_loaded{[&]() {
+        int loaded{};
+        for (bool is_done : {is_loaded(pending_sprite_sheet), is_loaded(pending_theme), is_loaded(pending_gift), is_loaded(pending_house), is_loaded(pending_hurt), is_loaded(pending_step), is_loaded(pending_spawn)})
+        {
+            loaded += is_done ? 1 : 0;
+        }
+        return loaded;
+    }};
+    constexpr int assets_to_load{7};
+    int loading_frames{};
+    for (int loaded{count_loaded()}; loaded < assets_to_load; loaded = count_loaded())
+    {
+        SDL_Event event{};
+        while (SDL_PollEvent(&event))
+        {
+            if (event.type == SDL_QUIT)
+            {
+                // the decoding threads are waited for as the pending assets go out of scope
+                return 0;
+            }
+        }
+        render_loading(renderer.Handle(), loaded, assets_to_load);
+        SDL_RenderPresent(renderer.Handle());
+        loading_frames++;
+        SDL_WaitEventTimeout(nullptr, LOADING_FRAME_MS);
+    }
+
+    // only the upload is left for the main thread
+    SDL2ExTexture sprite_sheet{renderer, *pending_sprite_sheet.get()};
+    std::unique_ptr<SDL2ExMusic> theme{pending_theme.get()};
+    std::unique_ptr<SDL2ExChunk> gift{pending_gift.get()};
+    std::unique_ptr<SDL2ExChunk> house{pending_house.get()};
+    std::unique_ptr<SDL2ExChunk> hurt{pending_hurt.get()};
+    std::unique_ptr<SDL2ExChunk> step{pending_step.get()};
+    std::unique_ptr<SDL2ExChunk> spawn{pending_spawn.get()};
+
+    // ------------------------------------------------------------------------
+    // main loop
+    // ------------------------------------------------------------------------
+
     GameState game_state{};
-    init_game_state(game_state);
+    seed_rng(game_state.rng, seed);
 
-    SoundEffects sfx{gift.Handle(), house.Handle(), hurt.Handle(), step.Handle(), spawn.Handle()};
+    // the simulation queues sounds, the main loop plays them once per frame
+    SoundEffects sfx{gift->Handle(), house->Handle(), hurt->Handle(), step->Handle(), spawn->Handle()};
+    AudioQueue audio_queue{};
+    AudioDispatcher audio{sfx, audio_queue};
 
     // start playing music (loops: -1 = infinite)
-    Mix_PlayMusic(theme.Handle(), -1);
+    Mix_PlayMusic(theme->Handle(), -1);
     Mix_VolumeMusic(16); // [0,128] // TODO: not here
 
-    GameScene game_scene{game_state, renderer.Handle(), sprite_sheet.Handle(), sfx};
-    GameOverScene game_over_scene{game_state, renderer.Handle(), sprite_sheet.Handle()};
+    ReplayRecorder recorder{};
+    ReplayRecorder *active_recorder{record_dir.empty() ? nullptr : &recorder};
+
+    SpriteBatch batch{renderer.Handle(), sprite_sheet.Handle()};
+    SDL2ExRenderTarget board_cache{renderer, LOGICAL_SCREEN_W, LOGICAL_SCREEN_H};
+    GameScene game_scene{batch, board_cache.Handle()};
+    GameOverScene game_over_scene{batch};
     // IScene *current_scene{&game_over_scene};
     IScene *current_scene{&game_scene};
 
+    // from here on the game state belongs to the simulation thread; this thread
+    // only sees the snapshots it publishes
+    Uint32 snapshot_event{SDL_RegisterEvents(1)};
+    if (snapshot_event == static_cast<Uint32>(-1))
+    {
+        error(std::format("failed to register an SDL2 event: {}", SDL_GetError()));
+    }
+    GameAutopilot autopilot{};
+    GameSimulation simulation{game_state, &audio_queue, active_recorder, use_autopilot ? &autopilot : nullptr};
+    SimulationThread simulation_thread{simulation, snapshot_event};
+    game_scene.show(simulation_thread.snapshot());
+    if (use_autopilot)
+    {
+        simulation_thread.send(SimCommand{SIM_COMMAND_START_GAME, DirectionIntent{}});
+    }
+
+#if defined(COZY_PROFILE)
+    bool show_profile{}; // F3 toggles the profiler overlay
+    Uint64 last_profile_title{};
+    uint32_t profiled_ticks{simulation_thread.snapshot().ticks};
+#else
+    constexpr bool show_profile{false};
+#endif
+    std::vector<FinishedReplay> finished_replays{};
+    FrameStats frame_stats{};
+    CpuUsage play_cpu{};
+    CpuUsage idle_cpu{};
+    bool exit{};
     Uint64 last_frame_start{SDL_GetPerformanceCounter()};
-    while (!game_state.exit)
+    while (!exit)
     {
         // compute last frame delta time
         Uint64 this_frame_start{SDL_GetPerformanceCounter()};
+        double frame_cpu_start{process_cpu_sec()};
         double dt_sec{static_cast<double>((this_frame_start - last_frame_start)) / static_cast<double>(SDL_GetPerformanceFrequency())};
         last_frame_start = this_frame_start;
 
         // process input
         {
+            PROFILE_SCOPE(PROFILE_EVENTS);
+
             // run message pump
             SDL_Event e;
             while (SDL_PollEvent(&e) != 0)
@@ -992,23 +502,57 @@ entry()
                 if (e.type == SDL_QUIT)
                 {
                     // user requests quit
-                    game_state.exit = true;
+                    exit = true;
+                }
+                else if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET)
+                {
+                    // render target contents are gone
+                    game_scene.invalidate_board_cache();
+                    current_scene->invalidate();
+                }
+                else if (e.type == SDL_WINDOWEVENT && (e.window.event == SDL_WINDOWEVENT_EXPOSED || e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED))
+                {
+                    // the window needs repainting even if nothing in the game changed
+                    current_scene->invalidate();
                 }
                 else if (e.type == SDL_KEYDOWN)
                 {
+                    // santa's turns are queued in the order they were pressed, held keys do not repeat them
+                    Direction direction{};
+                    if (e.key.repeat == 0 && key_direction(e.key.keysym.scancode, direction))
+                    {
+                        simulation_thread.send(SimCommand{SIM_COMMAND_TURN, DirectionIntent{direction, e.key.timestamp}});
+                    }
+
                     // key presses events
                     switch (e.key.keysym.sym)
                     {
                     case SDLK_RETURN:
                     {
-                        game_state.game_over = false; // TODO: not correct
+                        // start a new game only from the game over screen
+                        if (simulation_thread.snapshot().state.game_over)
+                        {
+                            simulation_thread.send(SimCommand{SIM_COMMAND_START_GAME, DirectionIntent{}});
+                        }
                     }
                     break;
                     case SDLK_ESCAPE:
                     {
-                        game_state.exit = true;
+                        exit = true;
+                    }
+                    break;
+#if defined(COZY_PROFILE)
+                    case SDLK_F3:
+                    {
+                        show_profile = !show_profile;
+                        current_scene->invalidate();
+                        if (!show_profile)
+                        {
+                            SDL_SetWindowTitle(window.Handle(), "Cozy Christmas");
+                        }
                     }
                     break;
+#endif
                     default:
                     {
                         // do nothing
@@ -1018,35 +562,178 @@ entry()
             }
         }
 
-        // switch scene
-        if (game_state.game_over)
+        // draw the latest tick the simulation thread published
+        if (simulation_thread.update_snapshot())
+        {
+            const GameSnapshot &snapshot{simulation_thread.snapshot()};
+            game_scene.show(snapshot);
+
+            // the autopilot goes straight on to the next game
+            if (use_autopilot && snapshot.state.game_over)
+            {
+                simulation_thread.send(SimCommand{SIM_COMMAND_START_GAME, DirectionIntent{}});
+            }
+#if defined(COZY_PROFILE)
+            // ticks are timed where they run and the times travel with the snapshots;
+            // a tick whose snapshot was overwritten before this thread saw it goes unrecorded
+            if (snapshot.ticks != profiled_ticks)
+            {
+                histogram_record(global_profiler.phases[PROFILE_SIM], snapshot.tick_ns);
+                profiled_ticks = snapshot.ticks;
+            }
+#endif
+        }
+        const GameSnapshot &snapshot{simulation_thread.snapshot()};
+
+        // save the games the simulation finished, here rather than between its ticks
+        simulation_thread.take_mail(finished_replays);
+        save_replays(record_dir, finished_replays);
+
+        // switch scene; the one we switch to has nothing on screen yet
+        IScene *next_scene{};
+        if (snapshot.state.game_over)
         {
-            current_scene = &game_over_scene;
+            next_scene = &game_over_scene;
         }
         else
         {
-            init_game_state(game_state);
-            current_scene = &game_scene;
+            next_scene = &game_scene;
+        }
+        if (next_scene != current_scene)
+        {
+            current_scene = next_scene;
+            current_scene->invalidate();
         }
 
         // update scene
-        current_scene->update(dt_sec);
+        {
+            PROFILE_SCOPE(PROFILE_UPDATE);
+            current_scene->update(dt_sec);
+        }
 
-        // render scene
-        current_scene->render();
+        // play what the ticks since the last frame queued
+        audio.dispatch();
 
-        // present
-        SDL_RenderPresent(renderer.Handle());
+        if (current_scene->is_dirty() || show_profile)
+        {
+            // render scene, in between the last tick and the next one; if the next one
+            // is late, everything waits where the last one left it
+            {
+                PROFILE_SCOPE(PROFILE_RENDER);
+                double since_tick_sec{static_cast<double>(SDL_GetPerformanceCounter() - snapshot.tick_time) / static_cast<double>(SDL_GetPerformanceFrequency())};
+                current_scene->render(std::min(since_tick_sec / SEC_PER_TICK, 1.0));
+#if defined(COZY_PROFILE)
+                if (show_profile)
+                {
+                    render_profile_overlay(batch, global_profiler);
+                }
+#endif
+            }
+
+            // frame time is the work up to here; presenting may wait for vsync
+            {
+                double frame_sec{static_cast<double>(SDL_GetPerformanceCounter() - this_frame_start) / static_cast<double>(SDL_GetPerformanceFrequency())};
+                frame_stats.frames++;
+                frame_stats.draw_calls += batch.take_draw_calls();
+                frame_stats.total_sec += frame_sec;
+                frame_stats.max_sec = std::max(frame_stats.max_sec, frame_sec);
+            }
+
+            // present
+            {
+                PROFILE_SCOPE(PROFILE_PRESENT);
+                SDL_RenderPresent(renderer.Handle());
+            }
+#if defined(COZY_PROFILE)
+            // only drawn frames are timed, so the sleeps of an idle screen stay out of the frame times
+            {
+                double frame_ns{static_cast<double>(SDL_GetPerformanceCounter() - this_frame_start) * 1e9 / static_cast<double>(SDL_GetPerformanceFrequency())};
+                histogram_record(global_profiler.phases[PROFILE_FRAME], static_cast<uint64_t>(frame_ns));
+            }
+#endif
+
+            // startup cost, from before sdl was initialized to the first frame on screen
+            if (frame_stats.frames == 1)
+            {
+                double startup_sec{static_cast<double>(SDL_GetPerformanceCounter() - startup_start) / static_cast<double>(SDL_GetPerformanceFrequency())};
+                std::cout << std::format("first frame: {:.1f} ms (assets from {}, {} loading frames)\n", startup_sec * 1000.0, assets.is_packed() ? "the pack" : "loose files", loading_frames);
+            }
+        }
+        else
+        {
+            // the screen is up to date: sleep until some input arrives or the simulation
+            // publishes a snapshot
+            SDL_WaitEvent(nullptr);
+        }
+
+#if defined(COZY_PROFILE)
+        // the numbers go in the window title, refreshed once a second
+        if (show_profile && this_frame_start - last_profile_title >= SDL_GetPerformanceFrequency())
+        {
+            last_profile_title = this_frame_start;
+            SDL_SetWindowTitle(window.Handle(), profile_title(global_profiler).c_str());
+        }
+#endif
+
+        // charge the cpu time of this frame to the scene it was spent on
+        {
+            CpuUsage &usage{current_scene == &game_scene ? play_cpu : idle_cpu};
+            usage.wall_sec += static_cast<double>(SDL_GetPerformanceCounter() - this_frame_start) / static_cast<double>(SDL_GetPerformanceFrequency());
+            usage.cpu_sec += process_cpu_sec() - frame_cpu_start;
+        }
+    }
+
+    // the simulation is this thread's again once its thread is gone; a game it
+    // finished after the last frame still gets saved
+    simulation_thread.stop();
+    simulation_thread.take_mail(finished_replays);
+    save_replays(record_dir, finished_replays);
+
+    if (frame_stats.frames > 0)
+    {
+        double frames{static_cast<double>(frame_stats.frames)};
+        std::cout << std::format("frames: {}, {:.1f} draw calls per frame, frame time mean {:.3f} ms, max {:.3f} ms\n", frame_stats.frames, static_cast<double>(frame_stats.draw_calls) / frames, frame_stats.total_sec / frames * 1000.0, frame_stats.max_sec * 1000.0);
+    }
+
+#if defined(COZY_PROFILE)
+    write_profile_csv(global_profiler, "profile.csv", "profile_histogram.csv");
+    std::cout << "profile: profile.csv, profile_histogram.csv\n";
+#endif
+
+    // cpu time per second of wall time, over every thread of the process (audio included)
+    for (auto [name, usage] : {std::pair{"playing", play_cpu}, std::pair{"game over screen", idle_cpu}})
+    {
+        if (usage.wall_sec > 0.0)
+        {
+            std::cout << std::format("cpu {}: {:.1f}% of a core over {:.1f} s\n", name, usage.cpu_sec / usage.wall_sec * 100.0, usage.wall_sec);
+        }
+    }
+
+    // how long turns waited for their tick (half a tick on average is the floor)
+    const InputLatency &latency{simulation.input_latency()};
+    if (latency.turns > 0)
+    {
+        std::cout << std::format("input latency: {} turns, mean {:.1f} ms, max {} ms\n", latency.turns, static_cast<double>(latency.total_ms) / static_cast<double>(latency.turns), latency.max_ms);
+    }
+
+    // what steering cost the simulation thread, per tick
+    const AutopilotStats &autopilot_stats{autopilot.stats()};
+    if (autopilot_stats.ticks > 0)
+    {
+        std::cout << std::format("autopilot: {} ticks, mean {:.2f} us, max {:.2f} us, {} replans, {} repairs\n", autopilot_stats.ticks, static_cast<double>(autopilot_stats.total_ns) / static_cast<double>(autopilot_stats.ticks) / 1e3, static_cast<double>(autopilot_stats.max_ns) / 1e3, autopilot_stats.replans, autopilot_stats.repairs);
     }
 
+    const AudioStats &audio_stats{audio.stats()};
+    std::cout << std::format("sounds: {} played ({} over a less important one), {} coalesced, {} dropped\n", audio_stats.played, audio_stats.replaced, audio_stats.coalesced, audio_stats.dropped);
+
     return 0;
 }
 
-int main()
+int main(int argc, char **argv)
 {
     try
     {
-        entry();
+        return entry(argc, argv);
     }
     catch (const Error &error)
     {
@@ -0,0 +1,82 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// whole-file reads and writes, and read-only memory mappings
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+inline std::vector<uint8_t> read_file(const std::string &path)
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file)
+    {
+        error(std::format("failed to open '{}'", path));
+    }
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+}
+
+inline void write_file(const std::string &path, const std::vector<uint8_t> &bytes)
+{
+    std::ofstream file{path, std::ios::binary};
+    file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!file)
+    {
+        error(std::format("failed to write '{}'", path));
+    }
+}
+
+// read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile(const std::string &path) : m_data{}, m_size{}
+    {
+        int fd{::open(path.c_str(), O_RDONLY)};
+        if (fd < 0)
+        {
+            error(std::format("failed to open '{}'", path));
+        }
+        struct stat info{};
+        if (::fstat(fd, &info) < 0 || info.st_size <= 0)
+        {
+            ::close(fd);
+            error(std::format("failed to map '{}': empty or unreadable", path));
+        }
+        m_size = static_cast<size_t>(info.st_size);
+        void *data{::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0)};
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            error(std::format("failed to map '{}'", path));
+        }
+        m_data = static_cast<const uint8_t *>(data);
+    }
+    ~MappedFile() noexcept
+    {
+        ::munmap(const_cast<uint8_t *>(m_data), m_size);
+    }
+    MappedFile(const MappedFile &) noexcept = delete;
+    MappedFile(MappedFile &&) noexcept = delete;
+    MappedFile &operator=(const MappedFile &) noexcept = delete;
+    MappedFile &operator=(MappedFile &&) noexcept = delete;
+
+public:
+    const uint8_t *data() const noexcept { return m_data; }
+    size_t size() const noexcept { return m_size; }
+
+private:
+    const uint8_t *m_data;
+    size_t m_size;
+};
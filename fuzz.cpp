@@ -0,0 +1,437 @@
+// fuzz driver: plays many games with random directions on every core, now and
+// then one the game would refuse (straight back onto the bags), and checks the
+// rule invariants after every tick. A game that breaks one is played again to
+// get its directions back, shrunk to as few ticks and turns as still break the
+// same invariant, and saved as a replay; --replay plays one back with the checks.
+// --swarm N fuzzes swarms of N agents instead, with little room for bags so
+// that the trails fill up; a broken swarm is reported by game and tick, which
+// the seed plays again
+
+#include "sim.hpp"
+#include "invariants.hpp"
+#include "replay.hpp"
+#include "swarm.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr int DEFAULT_FUZZ_GAMES{4096};
+constexpr int64_t DEFAULT_FUZZ_TICKS_PER_GAME{100'000};
+constexpr size_t MAX_FUZZ_FAILURES{16}; // distinct invariants broken, each minimized and saved
+constexpr int DEFAULT_FUZZ_SWARM_MAX_BAGS{3};
+
+// where a game that broke an invariant started, and how far it got
+struct FuzzFailure
+{
+    const char *message;
+    Rng game_rng;
+    Rng player_rng;
+    int64_t ticks;
+};
+
+// turns a quarter of the ticks, to a random direction; one that would run
+// santa straight back onto his bags only gets through one time in sixteen
+template <typename State>
+static void fuzz_player(State &state, Rng &rng)
+{
+    uint32_t bits{next_u32(rng)};
+    if ((bits & 3) != 0)
+    {
+        return;
+    }
+    Direction direction{static_cast<Direction>((bits >> 2) & 3)};
+    if (can_turn(state, direction) || ((bits >> 4) & 15) == 0)
+    {
+        state.santa_direction = direction;
+    }
+}
+
+// play 'directions' from a new game on 'rng'; the tick (counting from 0) that
+// broke 'message', or -1 if none of them did
+template <typename State>
+static int64_t first_failure(const State &prototype, const Rng &rng, const std::vector<Direction> &directions, const char *message)
+{
+    State state{prototype};
+    state.rng = rng;
+    init_game_state(state);
+    for (size_t tick{}; tick < directions.size() && !state.game_over; tick++)
+    {
+        state.santa_direction = directions[tick];
+        update_game_state(state);
+        const char *failure{check_invariants(state)};
+        if (failure)
+        {
+            return failure == message ? static_cast<int64_t>(tick) : -1;
+        }
+    }
+    return -1;
+}
+
+// shrink the directions that break the invariant: drop runs of ticks, then
+// straighten runs of turns, halving the run length down to single ticks
+template <typename State>
+static std::vector<Direction> minimize(const State &prototype, const Rng &rng, std::vector<Direction> directions, const char *message)
+{
+    for (bool is_straightening : {false, true})
+    {
+        for (size_t run{std::max<size_t>(1, directions.size() / 2)}; run > 0; run /= 2)
+        {
+            for (size_t start{}; start < directions.size();)
+            {
+                std::vector<Direction> candidate{directions};
+                size_t end{std::min(start + run, candidate.size())};
+                if (is_straightening)
+                {
+                    Direction straight{start > 0 ? candidate[start - 1] : DIRECTION_WEST};
+                    std::fill(candidate.begin() + static_cast<std::ptrdiff_t>(start), candidate.begin() + static_cast<std::ptrdiff_t>(end), straight);
+                }
+                else
+                {
+                    candidate.erase(candidate.begin() + static_cast<std::ptrdiff_t>(start), candidate.begin() + static_cast<std::ptrdiff_t>(end));
+                }
+                int64_t tick{candidate != directions ? first_failure(prototype, rng, candidate, message) : -1};
+                if (tick >= 0)
+                {
+                    candidate.resize(static_cast<size_t>(tick) + 1);
+                    directions = std::move(candidate);
+                }
+                else
+                {
+                    start += run;
+                }
+            }
+        }
+    }
+    return directions;
+}
+
+static int64_t count_turns(const std::vector<Direction> &directions)
+{
+    int64_t turns{};
+    Direction last{DIRECTION_WEST};
+    for (Direction direction : directions)
+    {
+        turns += direction != last;
+        last = direction;
+    }
+    return turns;
+}
+
+// play the failed game again to get its directions back, shrink them and save them
+template <typename State>
+static void save_failure(const State &prototype, const FuzzFailure &failure, const std::string &path)
+{
+    std::vector<Direction> directions{};
+    State state{prototype};
+    state.rng = failure.game_rng;
+    init_game_state(state);
+    Rng player_rng{failure.player_rng};
+    for (int64_t tick{}; tick < failure.ticks; tick++)
+    {
+        fuzz_player(state, player_rng);
+        directions.push_back(state.santa_direction);
+        update_game_state(state);
+    }
+    if (first_failure(prototype, failure.game_rng, directions, failure.message) < 0)
+    {
+        error(std::format("'{}' did not happen again when the game was played back", failure.message));
+    }
+    std::vector<Direction> minimized{minimize(prototype, failure.game_rng, directions, failure.message)};
+
+    ReplayRecorder recorder{};
+    state = prototype;
+    state.rng = failure.game_rng;
+    init_game_state(state);
+    recorder.begin(state);
+    for (Direction direction : minimized)
+    {
+        recorder.record_tick(direction);
+        state.santa_direction = direction;
+        update_game_state(state);
+    }
+    write_file(path, recorder.finish(state));
+    std::cout << std::format("FAIL {}: {} ticks, {} turns (from {} ticks, {} turns) -> {}\n", failure.message, minimized.size(), count_turns(minimized), directions.size(), count_turns(directions), path);
+}
+
+struct FuzzOptions
+{
+    int games;
+    int64_t ticks; // per game
+    int threads;
+    uint64_t seed;
+    std::string out_dir; // where failures are saved
+    int swarm_agents; // 0 to fuzz single games
+    int swarm_max_bags;
+};
+
+template <typename State>
+static int fuzz(const State &prototype, const FuzzOptions &options)
+{
+    std::mutex failures_mutex{};
+    std::vector<FuzzFailure> failures{};
+    std::atomic<int64_t> games_finished{};
+
+    // every game and every player gets its own stream of the seed, like the batch simulator
+    auto run_games{[&](int first, int last) {
+        int64_t finished{};
+        for (int i{first}; i < last; i++)
+        {
+            State state{prototype};
+            Rng player_rng{};
+            seed_rng(state.rng, options.seed, 2 * static_cast<uint64_t>(i));
+            seed_rng(player_rng, options.seed, 2 * static_cast<uint64_t>(i) + 1);
+            init_game_state(state);
+            Rng start_rng{state.rng};
+            Rng start_player_rng{player_rng};
+            int64_t game_ticks{};
+            for (int64_t tick{}; tick < options.ticks; tick++)
+            {
+                fuzz_player(state, player_rng);
+                update_game_state(state);
+                game_ticks++;
+                const char *failure{check_invariants(state)};
+                if (failure)
+                {
+                    std::lock_guard<std::mutex> lock{failures_mutex};
+                    bool is_new{std::none_of(failures.begin(), failures.end(), [failure](const FuzzFailure &f) { return f.message == failure; })};
+                    if (is_new && failures.size() < MAX_FUZZ_FAILURES)
+                    {
+                        failures.push_back(FuzzFailure{failure, start_rng, start_player_rng, game_ticks});
+                    }
+                }
+                if (state.game_over || failure)
+                {
+                    init_game_state(state);
+                    start_rng = state.rng;
+                    start_player_rng = player_rng;
+                    game_ticks = 0;
+                    finished++;
+                }
+            }
+        }
+        games_finished.fetch_add(finished, std::memory_order_relaxed);
+    }};
+
+    auto start{std::chrono::steady_clock::now()};
+    {
+        ThreadPool pool{options.threads};
+        int games_per_task{std::max(1, options.games / (options.threads * 8))};
+        for (int first{}; first < options.games; first += games_per_task)
+        {
+            int last{std::min(first + games_per_task, options.games)};
+            pool.submit([&run_games, first, last]() { run_games(first, last); });
+        }
+        pool.wait_idle();
+    }
+    double elapsed_sec{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    int64_t ticks{options.ticks * options.games};
+    std::cout << std::format("seed: {}\n", options.seed);
+    std::cout << std::format("games: {} on {}x{} boards ({} ticks each, {} threads)\n", options.games, prototype.board.rows(), prototype.board.cols(), options.ticks, options.threads);
+    std::cout << std::format("ticks: {} ({} games finished)\n", ticks, games_finished.load());
+    std::cout << std::format("elapsed: {:.3f} s\n", elapsed_sec);
+    std::cout << std::format("ticks/sec: {:.0f} ({:.0f} per thread)\n", static_cast<double>(ticks) / elapsed_sec, static_cast<double>(ticks) / elapsed_sec / static_cast<double>(options.threads));
+
+    for (size_t i{}; i < failures.size(); i++)
+    {
+        std::filesystem::create_directories(options.out_dir);
+        save_failure(prototype, failures[i], std::format("{}/fuzz_{}_{}{}", options.out_dir, options.seed, i, REPLAY_EXTENSION));
+    }
+    std::cout << std::format("invariants broken: {}\n", failures.size());
+    return failures.empty() ? 0 : 1;
+}
+
+// the swarm bots, except that now and then an agent turns anywhere, into bags,
+// houses without bags or back onto its own trail
+template <typename State>
+static void fuzz_swarm_players(State &state, Rng &rng)
+{
+    steer_swarm_bots(state, rng);
+    for (Direction &direction : state.agent_direction)
+    {
+        uint32_t bits{next_u32(rng)};
+        if ((bits & 31) == 0)
+        {
+            direction = static_cast<Direction>((bits >> 5) & 3);
+        }
+    }
+}
+
+// swarm games on every core, with the swarm checks after every tick; game i
+// plays from streams 2i and 2i + 1 of the seed, like the single games
+template <typename State>
+static int fuzz_swarm(const State &prototype, const FuzzOptions &options)
+{
+    std::mutex failures_mutex{};
+    std::vector<FuzzFailure> failures{};
+    std::vector<int> failed_games{};
+
+    auto run_games{[&](int first, int last) {
+        for (int i{first}; i < last; i++)
+        {
+            State state{prototype};
+            Rng player_rng{};
+            seed_rng(state.rng, options.seed, 2 * static_cast<uint64_t>(i));
+            seed_rng(player_rng, options.seed, 2 * static_cast<uint64_t>(i) + 1);
+            state.max_bags = options.swarm_max_bags;
+            init_swarm_state(state, options.swarm_agents);
+            for (int64_t tick{}; tick < options.ticks; tick++)
+            {
+                fuzz_swarm_players(state, player_rng);
+                update_swarm_state(state);
+                const char *failure{check_swarm_invariants(state)};
+                if (failure)
+                {
+                    std::lock_guard<std::mutex> lock{failures_mutex};
+                    bool is_new{std::none_of(failures.begin(), failures.end(), [failure](const FuzzFailure &f) { return f.message == failure; })};
+                    if (is_new && failures.size() < MAX_FUZZ_FAILURES)
+                    {
+                        failures.push_back(FuzzFailure{failure, Rng{}, Rng{}, tick});
+                        failed_games.push_back(i);
+                    }
+                    break;
+                }
+            }
+        }
+    }};
+
+    auto start{std::chrono::steady_clock::now()};
+    {
+        ThreadPool pool{options.threads};
+        int games_per_task{std::max(1, options.games / (options.threads * 8))};
+        for (int first{}; first < options.games; first += games_per_task)
+        {
+            int last{std::min(first + games_per_task, options.games)};
+            pool.submit([&run_games, first, last]() { run_games(first, last); });
+        }
+        pool.wait_idle();
+    }
+    double elapsed_sec{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    int64_t ticks{options.ticks * options.games};
+    std::cout << std::format("seed: {}\n", options.seed);
+    std::cout << std::format("swarms: {} of {} agents on {}x{} boards (room for {} bags each, {} ticks each, {} threads)\n", options.games, options.swarm_agents, prototype.board.rows(), prototype.board.cols(), options.swarm_max_bags, options.ticks, options.threads);
+    std::cout << std::format("elapsed: {:.3f} s\n", elapsed_sec);
+    std::cout << std::format("ticks/sec: {:.0f} ({:.0f} per thread)\n", static_cast<double>(ticks) / elapsed_sec, static_cast<double>(ticks) / elapsed_sec / static_cast<double>(options.threads));
+    for (size_t i{}; i < failures.size(); i++)
+    {
+        std::cout << std::format("FAIL {}: game {}, tick {}\n", failures[i].message, failed_games[i], failures[i].ticks);
+    }
+    std::cout << std::format("invariants broken: {}\n", failures.size());
+    return failures.empty() ? 0 : 1;
+}
+
+// play a replay back with the checks after every tick
+template <typename State>
+static int check_replay(State state, const Replay &replay)
+{
+    state.rng = replay.rng;
+    init_game_state(state);
+    for (size_t tick{}; tick < replay.directions.size(); tick++)
+    {
+        state.santa_direction = replay.directions[tick];
+        update_game_state(state);
+        const char *failure{check_invariants(state)};
+        if (failure)
+        {
+            std::cout << std::format("tick {}: {}\n", tick, failure);
+            return 1;
+        }
+    }
+    std::cout << std::format("no invariant broken in {} ticks\n", replay.directions.size());
+    return 0;
+}
+
+static int entry(int argc, char **argv)
+{
+    FuzzOptions options{DEFAULT_FUZZ_GAMES, DEFAULT_FUZZ_TICKS_PER_GAME, std::max(1, static_cast<int>(std::thread::hardware_concurrency())), std::random_device{}(), ".", 0, DEFAULT_FUZZ_SWARM_MAX_BAGS};
+    int side{MAP_SIDE};
+    std::string replay_path{};
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--games" && i + 1 < argc)
+        {
+            options.games = std::atoi(argv[++i]);
+        }
+        else if (arg == "--ticks" && i + 1 < argc)
+        {
+            options.ticks = std::atoll(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            options.threads = std::atoi(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--side" && i + 1 < argc)
+        {
+            side = std::atoi(argv[++i]);
+        }
+        else if (arg == "--out" && i + 1 < argc)
+        {
+            options.out_dir = argv[++i];
+        }
+        else if (arg == "--swarm" && i + 1 < argc)
+        {
+            options.swarm_agents = std::atoi(argv[++i]);
+        }
+        else if (arg == "--max-bags" && i + 1 < argc)
+        {
+            options.swarm_max_bags = std::atoi(argv[++i]);
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            replay_path = argv[++i];
+        }
+        else
+        {
+            error(std::format("unknown argument '{}' (usage: fuzz [--games N] [--ticks N] [--threads N] [--seed N] [--side N] [--out DIR] [--swarm N [--max-bags N]] | fuzz --replay FILE)", arg));
+        }
+    }
+    if (options.games <= 0)
+    {
+        error(std::format("fuzzing needs at least one game (got {})", options.games));
+    }
+
+    if (!replay_path.empty())
+    {
+        std::vector<uint8_t> bytes{read_file(replay_path)};
+        Replay replay{parse_replay(bytes.data(), bytes.size())};
+        return with_board_state<BasicGameState, MAP_SIDE>(replay.rows, replay.cols, [&replay](auto state) { return check_replay(state, replay); });
+    }
+
+    if (options.swarm_agents > 0)
+    {
+        return with_board_state<BasicSwarmState, MAP_SIDE>(side, side, [&options](auto prototype) { return fuzz_swarm(prototype, options); });
+    }
+    return with_board_state<BasicGameState, MAP_SIDE>(side, side, [&options](auto prototype) { return fuzz(prototype, options); });
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return entry(argc, argv);
+    }
+    catch (const Error &error)
+    {
+        std::cerr << error.what() << "\n";
+    }
+
+    return 1;
+}
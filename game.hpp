@@ -0,0 +1,1275 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// the game on top of SDL: RAII wrappers, the sprite batch, input, the simulation
+// and the thread it runs on, and the scenes. Shared by the game and by the tools
+// that drive the scenes without a window
+// ----------------------------------------------------------------------------
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_mixer.h>
+
+#include "sim.hpp"
+#include "replay.hpp"
+#include "profiler.hpp"
+#include "asset_pack.hpp"
+#include "audio.hpp"
+#include "autopilot.hpp"
+#include "spsc_ring.hpp"
+#include "triple_buffer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr int SCREEN_W{720};
+constexpr int SCREEN_H{720};
+constexpr int TILE_PIXEL_SIZE{14}; // TODO: find a better name
+constexpr int LOGICAL_SCREEN_W{MAP_SIDE * TILE_PIXEL_SIZE};
+constexpr int LOGICAL_SCREEN_H{MAP_SIDE * TILE_PIXEL_SIZE};
+
+class SDL2ExHandle
+{
+public:
+    SDL2ExHandle()
+    {
+        int res{SDL_Init(SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS)};
+        if (res < 0)
+        {
+            error(std::format("failed to initialize SDL2: {}", SDL_GetError()));
+        }
+    }
+    ~SDL2ExHandle() noexcept
+    {
+        SDL_Quit();
+    }
+    SDL2ExHandle(const SDL2ExHandle &) noexcept = delete;
+    SDL2ExHandle(SDL2ExHandle &&) noexcept = delete;
+    SDL2ExHandle &operator=(const SDL2ExHandle &) noexcept = delete;
+    SDL2ExHandle &operator=(SDL2ExHandle &&) noexcept = delete;
+};
+
+class SDL2ExImageHandle
+{
+public:
+    SDL2ExImageHandle()
+    {
+        int result{IMG_Init(IMG_INIT_PNG)};
+        if (!(result & IMG_INIT_PNG))
+        {
+            error(std::format("failed to initialize SDL2 image: {}", IMG_GetError()));
+        }
+    }
+    ~SDL2ExImageHandle() noexcept
+    {
+        IMG_Quit();
+    }
+    SDL2ExImageHandle(const SDL2ExImageHandle &) noexcept = delete;
+    SDL2ExImageHandle(SDL2ExImageHandle &&) noexcept = delete;
+    SDL2ExImageHandle &operator=(const SDL2ExImageHandle &) noexcept = delete;
+    SDL2ExImageHandle &operator=(SDL2ExImageHandle &&) noexcept = delete;
+};
+
+class SDL2ExMixerHandle
+{
+public:
+    SDL2ExMixerHandle()
+    {
+        // Initialize SDL_mixer for Audio (44.1khz, default format, 2 channels, 2048 chunk size)
+        int res{Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048)};
+        if (res < 0)
+        {
+            error(std::format("failed to initialize SDL2 mixer: {}", Mix_GetError()));
+        }
+    }
+    ~SDL2ExMixerHandle() noexcept
+    {
+        Mix_Quit();
+    }
+    SDL2ExMixerHandle(const SDL2ExMixerHandle &) noexcept = delete;
+    SDL2ExMixerHandle(SDL2ExMixerHandle &&) noexcept = delete;
+    SDL2ExMixerHandle &operator=(const SDL2ExMixerHandle &) noexcept = delete;
+    SDL2ExMixerHandle &operator=(SDL2ExMixerHandle &&) noexcept = delete;
+};
+
+class SDL2ExWindow
+{
+public:
+    SDL2ExWindow() : handle{}
+    {
+        handle = SDL_CreateWindow("Cozy Christmas",
+                                  SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                  SCREEN_W, SCREEN_H,
+                                  SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_MAXIMIZED);
+        if (!handle)
+        {
+            error(std::format("failed to create SDL2 window: {}", SDL_GetError()));
+        }
+    }
+    ~SDL2ExWindow() noexcept
+    {
+        SDL_DestroyWindow(handle);
+    }
+    SDL2ExWindow(const SDL2ExWindow &) noexcept = delete;
+    SDL2ExWindow(SDL2ExWindow &&) noexcept = delete;
+    SDL2ExWindow &operator=(const SDL2ExWindow &) noexcept = delete;
+    SDL2ExWindow &operator=(SDL2ExWindow &&) noexcept = delete;
+
+public:
+    constexpr SDL_Window *Handle() const noexcept { return handle; }
+
+private:
+    SDL_Window *handle;
+};
+
+class SDL2ExRenderer
+{
+public:
+    SDL2ExRenderer(SDL_Window *window) : handle{}
+    {
+        // Create Renderer (Hardware accelerated, VSync enabled, able to draw into textures)
+        handle = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
+        if (!handle)
+        {
+            error(std::format("failed to create SDL2 renderer: {}", SDL_GetError()));
+        }
+    }
+    SDL2ExRenderer(SDL_Surface *surface) : handle{}
+    {
+        // Create Renderer (Software, drawing straight into the surface: no window or gpu needed)
+        handle = SDL_CreateSoftwareRenderer(surface);
+        if (!handle)
+        {
+            error(std::format("failed to create SDL2 software renderer: {}", SDL_GetError()));
+        }
+    }
+    ~SDL2ExRenderer() noexcept
+    {
+        SDL_DestroyRenderer(handle);
+    }
+    SDL2ExRenderer(const SDL2ExRenderer &) noexcept = delete;
+    SDL2ExRenderer(SDL2ExRenderer &&) noexcept = delete;
+    SDL2ExRenderer &operator=(const SDL2ExRenderer &) noexcept = delete;
+    SDL2ExRenderer &operator=(SDL2ExRenderer &&) noexcept = delete;
+
+public:
+    constexpr SDL_Renderer *Handle() const noexcept { return handle; }
+
+private:
+    SDL_Renderer *handle;
+};
+
+// where assets come from: the pack when one was built, the loose files next to
+// it otherwise (during development, or for anything the pack does not have)
+class AssetSource
+{
+public:
+    AssetSource(const std::string &dir, const std::string &pack_name) : m_dir{dir}, m_pack{}
+    {
+        std::string pack_path{dir + "/" + pack_name};
+        if (std::filesystem::is_regular_file(pack_path))
+        {
+            m_pack = std::make_unique<AssetPack>(pack_path);
+        }
+    }
+    ~AssetSource() noexcept = default;
+    AssetSource(const AssetSource &) noexcept = delete;
+    AssetSource(AssetSource &&) noexcept = delete;
+    AssetSource &operator=(const AssetSource &) noexcept = delete;
+    AssetSource &operator=(AssetSource &&) noexcept = delete;
+
+public:
+    bool is_packed() const noexcept { return m_pack != nullptr; }
+    // the packed entry for file 'name' if it holds that kind of asset, null to load the loose file
+    const AssetEntry *packed(const char *name, AssetKind kind) const noexcept
+    {
+        const AssetEntry *entry{m_pack ? m_pack->find(name) : nullptr};
+        return entry && entry->kind == kind ? entry : nullptr;
+    }
+    const uint8_t *data(const AssetEntry &entry) const noexcept { return m_pack->data(entry); }
+    std::string loose_path(const char *name) const { return m_dir + "/" + name; }
+
+private:
+    std::string m_dir;
+    std::unique_ptr<AssetPack> m_pack; // null without a pack
+};
+
+class SDL2ExSurface
+{
+public:
+    SDL2ExSurface(const char *file) : handle{}
+    {
+        handle = IMG_Load(file);
+        if (!handle)
+        {
+            error(std::format("failed to create SDL2 surface for file '{}': {}", file, IMG_GetError()));
+        }
+    }
+    SDL2ExSurface(int w, int h) : handle{}
+    {
+        handle = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA32);
+        if (!handle)
+        {
+            error(std::format("failed to create {}x{} SDL2 surface: {}", w, h, SDL_GetError()));
+        }
+    }
+    SDL2ExSurface(const AssetSource &assets, const char *name) : handle{}
+    {
+        const AssetEntry *entry{assets.packed(name, ASSET_IMAGE)};
+        if (entry)
+        {
+            // packed pixels are used in place; surfaces made over pixels never free or write them
+            int w{static_cast<int>(entry->width)};
+            int h{static_cast<int>(entry->height)};
+            handle = SDL_CreateRGBSurfaceWithFormatFrom(const_cast<uint8_t *>(assets.data(*entry)), w, h, 32, w * 4, SDL_PIXELFORMAT_RGBA32);
+            if (!handle)
+            {
+                error(std::format("failed to create SDL2 surface for asset '{}': {}", name, SDL_GetError()));
+            }
+        }
+        else
+        {
+            handle = IMG_Load(assets.loose_path(name).c_str());
+            if (!handle)
+            {
+                error(std::format("failed to create SDL2 surface for asset '{}': {}", name, IMG_GetError()));
+            }
+        }
+    }
+    ~SDL2ExSurface() noexcept
+    {
+        SDL_FreeSurface(handle);
+    }
+    SDL2ExSurface(const SDL2ExSurface &) noexcept = delete;
+    SDL2ExSurface(SDL2ExSurface &&) noexcept = delete;
+    SDL2ExSurface &operator=(const SDL2ExSurface &) noexcept = delete;
+    SDL2ExSurface &operator=(SDL2ExSurface &&) noexcept = delete;
+
+public:
+    constexpr SDL_Surface *Handle() const noexcept { return handle; }
+
+private:
+    SDL_Surface *handle;
+};
+
+class SDL2ExTexture
+{
+public:
+    SDL2ExTexture(const SDL2ExRenderer &renderer, const char *file) : handle{}
+    {
+        SDL2ExSurface tmp{file};
+        handle = SDL_CreateTextureFromSurface(renderer.Handle(), tmp.Handle());
+        if (!handle)
+        {
+            error(std::format("failed to create SDL2 texture for file '{}': {}", file, SDL_GetError()));
+        }
+    }
+    SDL2ExTexture(const SDL2ExRenderer &renderer, const SDL2ExSurface &surface) : handle{}
+    {
+        // the upload, the only part of loading a texture that has to happen on the renderer's thread
+        handle = SDL_CreateTextureFromSurface(renderer.Handle(), surface.Handle());
+        if (!handle)
+        {
+            error(std::format("failed to create SDL2 texture: {}", SDL_GetError()));
+        }
+    }
+    SDL2ExTexture(const SDL2ExRenderer &renderer, const AssetSource &assets, const char *name)
+        : SDL2ExTexture{renderer, SDL2ExSurface{assets, name}}
+    {
+    }
+    ~SDL2ExTexture() noexcept
+    {
+        SDL_DestroyTexture(handle);
+    }
+    SDL2ExTexture(const SDL2ExTexture &) noexcept = delete;
+    SDL2ExTexture(SDL2ExTexture &&) noexcept = delete;
+    SDL2ExTexture &operator=(const SDL2ExTexture &) noexcept = delete;
+    SDL2ExTexture &operator=(SDL2ExTexture &&) noexcept = delete;
+
+public:
+    constexpr SDL_Texture *Handle() const noexcept { return handle; }
+
+private:
+    SDL_Texture *handle;
+};
+
+class SDL2ExRenderTarget
+{
+public:
+    SDL2ExRenderTarget(const SDL2ExRenderer &renderer, int w, int h) : handle{}
+    {
+        handle = SDL_CreateTexture(renderer.Handle(), SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, w, h);
+        if (!handle)
+        {
+            error(std::format("failed to create {}x{} SDL2 render target: {}", w, h, SDL_GetError()));
+        }
+    }
+    ~SDL2ExRenderTarget() noexcept
+    {
+        SDL_DestroyTexture(handle);
+    }
+    SDL2ExRenderTarget(const SDL2ExRenderTarget &) noexcept = delete;
+    SDL2ExRenderTarget(SDL2ExRenderTarget &&) noexcept = delete;
+    SDL2ExRenderTarget &operator=(const SDL2ExRenderTarget &) noexcept = delete;
+    SDL2ExRenderTarget &operator=(SDL2ExRenderTarget &&) noexcept = delete;
+
+public:
+    constexpr SDL_Texture *Handle() const noexcept { return handle; }
+
+private:
+    SDL_Texture *handle;
+};
+
+class SDL2ExMusic
+{
+public:
+    SDL2ExMusic(const char *file) : handle{}
+    {
+        handle = Mix_LoadMUS(file);
+        if (!handle)
+        {
+            error(std::format("filed to load SDL2 music for file '{}': {}", file, Mix_GetError()));
+        }
+    }
+    SDL2ExMusic(const AssetSource &assets, const char *name) : handle{}
+    {
+        // music stays compressed in the pack too: the mixer streams it from memory
+        const AssetEntry *entry{assets.packed(name, ASSET_BLOB)};
+        if (entry)
+        {
+            handle = Mix_LoadMUS_RW(SDL_RWFromConstMem(assets.data(*entry), static_cast<int>(entry->size)), 1);
+        }
+        else
+        {
+            handle = Mix_LoadMUS(assets.loose_path(name).c_str());
+        }
+        if (!handle)
+        {
+            error(std::format("filed to load SDL2 music for asset '{}': {}", name, Mix_GetError()));
+        }
+    }
+    ~SDL2ExMusic() noexcept
+    {
+        Mix_FreeMusic(handle);
+    }
+    SDL2ExMusic(const SDL2ExMusic &) noexcept = delete;
+    SDL2ExMusic(SDL2ExMusic &&) noexcept = delete;
+    SDL2ExMusic &operator=(const SDL2ExMusic &) noexcept = delete;
+    SDL2ExMusic &operator=(SDL2ExMusic &&) noexcept = delete;
+
+public:
+    constexpr Mix_Music *Handle() const noexcept { return handle; }
+
+private:
+    Mix_Music *handle;
+};
+
+class SDL2ExChunk
+{
+public:
+    SDL2ExChunk(const char *file) : handle{}
+    {
+        handle = Mix_LoadWAV(file);
+        if (!handle)
+        {
+            error(std::format("failed to load SDL2 chunk for file '{}': {}", file, Mix_GetError()));
+        }
+    }
+    SDL2ExChunk(const AssetSource &assets, const char *name) : handle{}
+    {
+        // packed samples are played in place, as long as the mixer runs in the format they were packed for
+        const AssetEntry *entry{assets.packed(name, ASSET_PCM)};
+        int frequency{};
+        Uint16 format{};
+        int channels{};
+        bool is_playable{entry && Mix_QuerySpec(&frequency, &format, &channels) != 0 && static_cast<uint32_t>(frequency) == entry->frequency && format == entry->format && channels == entry->channels};
+        if (is_playable)
+        {
+            // the mixer never writes to the samples, so the read-only mapping is fine
+            handle = Mix_QuickLoad_RAW(const_cast<Uint8 *>(assets.data(*entry)), static_cast<Uint32>(entry->size));
+        }
+        else
+        {
+            handle = Mix_LoadWAV(assets.loose_path(name).c_str());
+        }
+        if (!handle)
+        {
+            error(std::format("failed to load SDL2 chunk for asset '{}': {}", name, Mix_GetError()));
+        }
+    }
+    ~SDL2ExChunk() noexcept
+    {
+        Mix_FreeChunk(handle);
+    }
+    SDL2ExChunk(const SDL2ExChunk &) noexcept = delete;
+    SDL2ExChunk(SDL2ExChunk &&) noexcept = delete;
+    SDL2ExChunk &operator=(const SDL2ExChunk &) noexcept = delete;
+    SDL2ExChunk &operator=(SDL2ExChunk &&) noexcept = delete;
+
+public:
+    constexpr Mix_Chunk *Handle() const noexcept { return handle; }
+
+private:
+    Mix_Chunk *handle;
+};
+
+// an asset being decoded on a thread of its own; get() hands it over, or rethrows
+// what decoding threw
+template <typename Asset>
+using PendingAsset = std::future<std::unique_ptr<Asset>>;
+
+// sdl_image and sdl_mixer decode without shared state, so every asset gets its own
+// thread and loading takes as long as the slowest one. 'assets' must outlive it
+template <typename Asset>
+inline PendingAsset<Asset> load_async(const AssetSource &assets, const char *name)
+{
+    return std::async(std::launch::async, [&assets, name]() { return std::make_unique<Asset>(assets, name); });
+}
+
+template <typename Asset>
+inline bool is_loaded(const PendingAsset<Asset> &pending)
+{
+    return pending.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+}
+
+// collects every sprite of a frame into one vertex and index buffer and draws
+// them all with a single SDL_RenderGeometry call; flipped sprites swap their uvs.
+// Clears, fills, copies and target switches go straight to the renderer, after
+// flushing what came before them
+class SpriteBatch
+{
+public:
+    SpriteBatch(SDL_Renderer *renderer, SDL_Texture *texture)
+        : m_renderer{renderer}, m_texture{texture}, m_texture_w{}, m_texture_h{}, m_vertices{}, m_indices{}, m_draw_calls{}
+    {
+        int w{};
+        int h{};
+        if (SDL_QueryTexture(texture, nullptr, nullptr, &w, &h) < 0)
+        {
+            error(std::format("failed to query sprite sheet size: {}", SDL_GetError()));
+        }
+        m_texture_w = static_cast<float>(w);
+        m_texture_h = static_cast<float>(h);
+    }
+    ~SpriteBatch() noexcept = default;
+    SpriteBatch(const SpriteBatch &) noexcept = delete;
+    SpriteBatch(SpriteBatch &&) noexcept = delete;
+    SpriteBatch &operator=(const SpriteBatch &) noexcept = delete;
+    SpriteBatch &operator=(SpriteBatch &&) noexcept = delete;
+
+public:
+    void clear(Uint8 r, Uint8 g, Uint8 b)
+    {
+        flush();
+        SDL_SetRenderDrawColor(m_renderer, r, g, b, 255);
+        SDL_RenderClear(m_renderer);
+        m_draw_calls++;
+    }
+    void fill_rect(const SDL_Rect &rect, Uint8 r, Uint8 g, Uint8 b)
+    {
+        flush();
+        SDL_SetRenderDrawColor(m_renderer, r, g, b, 255);
+        SDL_RenderFillRect(m_renderer, &rect);
+        m_draw_calls++;
+    }
+    void fill_rects(const std::vector<SDL_Rect> &rects, Uint8 r, Uint8 g, Uint8 b)
+    {
+        flush();
+        SDL_SetRenderDrawColor(m_renderer, r, g, b, 255);
+        SDL_RenderFillRects(m_renderer, rects.data(), static_cast<int>(rects.size()));
+        m_draw_calls++;
+    }
+    // copy a whole texture, such as a cached layer, onto the current target
+    void copy(SDL_Texture *texture, const SDL_Rect &dst)
+    {
+        flush();
+        SDL_RenderCopy(m_renderer, texture, nullptr, &dst);
+        m_draw_calls++;
+    }
+    // draw into 'texture' from now on, or back onto the screen with null
+    void set_target(SDL_Texture *texture)
+    {
+        flush();
+        if (SDL_SetRenderTarget(m_renderer, texture) < 0)
+        {
+            error(std::format("failed to set render target: {}", SDL_GetError()));
+        }
+    }
+    void sprite(const SDL_Rect &src, const SDL_FRect &dst, bool flip_horizontal)
+    {
+        float u0{static_cast<float>(src.x) / m_texture_w};
+        float v0{static_cast<float>(src.y) / m_texture_h};
+        float u1{static_cast<float>(src.x + src.w) / m_texture_w};
+        float v1{static_cast<float>(src.y + src.h) / m_texture_h};
+        if (flip_horizontal)
+        {
+            std::swap(u0, u1);
+        }
+
+        constexpr SDL_Color white{255, 255, 255, 255};
+        int first{static_cast<int>(m_vertices.size())};
+        m_vertices.push_back(SDL_Vertex{SDL_FPoint{dst.x, dst.y}, white, SDL_FPoint{u0, v0}});
+        m_vertices.push_back(SDL_Vertex{SDL_FPoint{dst.x + dst.w, dst.y}, white, SDL_FPoint{u1, v0}});
+        m_vertices.push_back(SDL_Vertex{SDL_FPoint{dst.x + dst.w, dst.y + dst.h}, white, SDL_FPoint{u1, v1}});
+        m_vertices.push_back(SDL_Vertex{SDL_FPoint{dst.x, dst.y + dst.h}, white, SDL_FPoint{u0, v1}});
+        for (int corner : {0, 1, 2, 0, 2, 3})
+        {
+            m_indices.push_back(first + corner);
+        }
+    }
+    void sprite(const SDL_Rect &src, const SDL_Rect &dst, bool flip_horizontal)
+    {
+        SDL_FRect fdst{static_cast<float>(dst.x), static_cast<float>(dst.y), static_cast<float>(dst.w), static_cast<float>(dst.h)};
+        sprite(src, fdst, flip_horizontal);
+    }
+    // draw everything queued so far; the buffers keep their capacity for the next frame
+    void flush()
+    {
+        if (m_indices.empty())
+        {
+            return;
+        }
+        if (SDL_RenderGeometry(m_renderer, m_texture, m_vertices.data(), static_cast<int>(m_vertices.size()), m_indices.data(), static_cast<int>(m_indices.size())) < 0)
+        {
+            error(std::format("failed to render sprites: {}", SDL_GetError()));
+        }
+        m_draw_calls++;
+        m_vertices.clear();
+        m_indices.clear();
+    }
+    // draw calls issued since the last call
+    int take_draw_calls() noexcept
+    {
+        int draw_calls{m_draw_calls};
+        m_draw_calls = 0;
+        return draw_calls;
+    }
+
+private:
+    SDL_Renderer *m_renderer;
+    SDL_Texture *m_texture;
+    float m_texture_w;
+    float m_texture_h;
+    std::vector<SDL_Vertex> m_vertices;
+    std::vector<int> m_indices;
+    int m_draw_calls;
+};
+
+// a key press that asks santa to face some direction, stamped with when sdl saw it (ms)
+struct DirectionIntent
+{
+    Direction direction;
+    Uint32 timestamp;
+};
+
+// key presses in the order they happened; the game takes at most one turn out of
+// it per tick, so quick presses in a row (W then D) become turns on consecutive ticks
+class InputQueue
+{
+public:
+    static constexpr int CAPACITY{4}; // a few ticks worth of turns; any more are mashing and get dropped
+
+public:
+    void push(DirectionIntent intent) noexcept
+    {
+        if (m_count < CAPACITY)
+        {
+            m_items[(m_head + m_count) % CAPACITY] = intent;
+            m_count++;
+        }
+    }
+    bool pop(DirectionIntent &intent) noexcept
+    {
+        if (m_count == 0)
+        {
+            return false;
+        }
+        intent = m_items[m_head];
+        m_head = (m_head + 1) % CAPACITY;
+        m_count--;
+        return true;
+    }
+    void clear() noexcept { m_head = m_count = 0; }
+
+private:
+    DirectionIntent m_items[CAPACITY]{};
+    int m_head{};
+    int m_count{};
+};
+
+// how long turns waited between the key press and the tick that applied them
+struct InputLatency
+{
+    int64_t turns;
+    uint64_t total_ms;
+    Uint32 max_ms;
+};
+
+// WASD and arrow keys map to directions; false for any other key
+inline bool key_direction(SDL_Scancode scancode, Direction &direction) noexcept
+{
+    switch (scancode)
+    {
+    case SDL_SCANCODE_W:
+    case SDL_SCANCODE_UP:
+    {
+        direction = DIRECTION_NORTH;
+    }
+    break;
+    case SDL_SCANCODE_S:
+    case SDL_SCANCODE_DOWN:
+    {
+        direction = DIRECTION_SOUTH;
+    }
+    break;
+    case SDL_SCANCODE_A:
+    case SDL_SCANCODE_LEFT:
+    {
+        direction = DIRECTION_WEST;
+    }
+    break;
+    case SDL_SCANCODE_D:
+    case SDL_SCANCODE_RIGHT:
+    {
+        direction = DIRECTION_EAST;
+    }
+    break;
+    default:
+    {
+        return false;
+    }
+    }
+    return true;
+}
+
+class IScene
+{
+public:
+    virtual void update(double dt_sec) = 0; // once per frame
+    virtual void render(double alpha) = 0;  // alpha: how far we are from the last tick to the next one, in [0, 1]
+    virtual bool is_dirty() const = 0;      // false when render would draw the last frame over again
+    virtual void invalidate() = 0;          // the last frame is gone (scene switch, exposed window): draw again
+
+public:
+    virtual ~IScene() noexcept = default;
+};
+
+class GameOverScene : public IScene
+{
+public:
+    explicit GameOverScene(SpriteBatch &batch) noexcept
+        : m_batch{batch}, m_is_dirty{true} {}
+    ~GameOverScene() noexcept override = default;
+    GameOverScene(const GameOverScene &) noexcept = delete;
+    GameOverScene(GameOverScene &&) noexcept = delete;
+    GameOverScene &operator=(const GameOverScene &) noexcept = delete;
+    GameOverScene &operator=(GameOverScene &&) noexcept = delete;
+
+public:
+    void update(double /*dt_sec*/) override
+    {
+    }
+    bool is_dirty() const override { return m_is_dirty; }
+    void invalidate() override { m_is_dirty = true; }
+    void render(double /*alpha*/) override
+    {
+        // the title screen never changes by itself
+        m_is_dirty = false;
+
+        // clear the screen to black
+        m_batch.clear(0, 0, 0);
+
+        // draw background, palette dark green (bounding boxes)
+        m_batch.fill_rect(SDL_Rect{0, 0, LOGICAL_SCREEN_W, LOGICAL_SCREEN_H}, 31, 50, 36);
+
+        constexpr int cozy_christmas_w{109};
+        constexpr int cozy_christmas_h{43};
+
+        SDL_Rect dst_rect{};
+        dst_rect.x = (LOGICAL_SCREEN_W / 2) - (cozy_christmas_w / 2);
+        dst_rect.y = (LOGICAL_SCREEN_H / 2) - (cozy_christmas_h / 2);
+        dst_rect.w = cozy_christmas_w;
+        dst_rect.h = cozy_christmas_h;
+
+        SDL_Rect src_rect{};
+        src_rect.x = 8;
+        src_rect.y = 33;
+        src_rect.w = cozy_christmas_w;
+        src_rect.h = cozy_christmas_h;
+
+        m_batch.sprite(src_rect, dst_rect, false);
+        m_batch.flush();
+    }
+
+private:
+    SpriteBatch &m_batch;
+    bool m_is_dirty;
+};
+
+// what the renderer sees of the game: the state as of the last tick, and as of
+// the tick before so that santa and his bags can slide from one to the other
+struct GameSnapshot
+{
+    GameState state;
+    GameState previous; // the same as state when a game has just started
+    uint32_t ticks;     // ticks run so far, across games
+    Uint64 tick_time;   // SDL_GetPerformanceCounter() when the last tick ran
+    uint64_t tick_ns;   // how long the last tick took
+};
+
+using GameAutopilot = Autopilot<MAP_SIDE, MAP_SIDE>;
+
+// a game the recorder finished, for whoever owns the simulation to save
+struct FinishedReplay
+{
+    uint64_t start_rng_state; // names the file
+    std::vector<uint8_t> bytes;
+};
+
+// the game without any drawing: turns from the input queue (or the autopilot),
+// the rules, the replay recorder and the sounds. Runs on whatever thread calls
+// tick(), and does no file io there: finished replays are handed out instead
+class GameSimulation
+{
+public:
+    GameSimulation(GameState &game_state, AudioQueue *audio, ReplayRecorder *recorder, GameAutopilot *autopilot) noexcept
+        : m_game_state{game_state}, m_previous{}, m_audio{audio}, m_ticks{}, m_tick_time{}, m_tick_ns{}, m_recorder{recorder}, m_finished_replays{}, m_autopilot{autopilot}, m_input{}, m_latency{}
+    {
+    }
+    ~GameSimulation() noexcept = default;
+    GameSimulation(const GameSimulation &) noexcept = delete;
+    GameSimulation(GameSimulation &&) noexcept = delete;
+    GameSimulation &operator=(const GameSimulation &) noexcept = delete;
+    GameSimulation &operator=(GameSimulation &&) noexcept = delete;
+
+public:
+    void tick()
+    {
+        // the game may end halfway through a burst of catch-up ticks
+        if (m_game_state.game_over)
+        {
+            return;
+        }
+
+        // remember where everything was, to slide from there to where it gets
+        m_previous = m_game_state;
+        m_tick_time = SDL_GetPerformanceCounter();
+
+        if (m_autopilot)
+        {
+            m_autopilot->steer(m_game_state);
+        }
+        else
+        {
+            // take the oldest turn that is still legal; turns that are not (back onto the
+            // bags, or where santa is already going) are dropped so they do not hold up the next
+            DirectionIntent intent{};
+            while (m_input.pop(intent))
+            {
+                if (intent.direction != m_game_state.santa_direction && can_turn(m_game_state, intent.direction))
+                {
+                    m_game_state.santa_direction = intent.direction;
+                    Uint32 latency_ms{SDL_GetTicks() - intent.timestamp};
+                    m_latency.turns++;
+                    m_latency.total_ms += latency_ms;
+                    m_latency.max_ms = std::max(m_latency.max_ms, latency_ms);
+                    break;
+                }
+            }
+        }
+
+        // log the input of this tick, if we are recording
+        if (m_recorder)
+        {
+            m_recorder->record_tick(m_game_state.santa_direction);
+        }
+
+        // update game
+        GameEvents events{update_game_state(m_game_state)};
+        m_tick_ns = static_cast<uint64_t>(static_cast<double>(SDL_GetPerformanceCounter() - m_tick_time) * 1e9 / static_cast<double>(SDL_GetPerformanceFrequency()));
+
+        // the game just ended: keep its replay for saving
+        if (m_recorder && m_game_state.game_over)
+        {
+            m_finished_replays.push_back(FinishedReplay{m_recorder->start_rng().state, m_recorder->finish(m_game_state)});
+        }
+
+        // queue sound effects for whatever happened during the tick
+        if (m_audio)
+        {
+            push_game_events(*m_audio, events, m_ticks);
+        }
+        m_ticks++;
+    }
+
+    // start a new game, with nothing sliding in from the last one
+    void start_game()
+    {
+        init_game_state(m_game_state);
+        m_input.clear();
+        if (m_recorder)
+        {
+            m_recorder->begin(m_game_state);
+        }
+        m_previous = m_game_state;
+        m_tick_time = SDL_GetPerformanceCounter();
+    }
+
+    // queue a turn for the coming ticks
+    void push_input(DirectionIntent intent) noexcept { m_input.push(intent); }
+    const InputLatency &input_latency() const noexcept { return m_latency; }
+    const GameState &state() const noexcept { return m_game_state; }
+
+    // move the replays of the games finished since the last call to the end of 'replays'
+    bool has_finished_replays() const noexcept { return !m_finished_replays.empty(); }
+    void take_finished_replays(std::vector<FinishedReplay> &replays)
+    {
+        std::move(m_finished_replays.begin(), m_finished_replays.end(), std::back_inserter(replays));
+        m_finished_replays.clear();
+    }
+
+    void snapshot(GameSnapshot &snapshot) const noexcept
+    {
+        snapshot.state = m_game_state;
+        snapshot.previous = m_previous;
+        snapshot.ticks = m_ticks;
+        snapshot.tick_time = m_tick_time;
+        snapshot.tick_ns = m_tick_ns;
+    }
+
+private:
+    GameState &m_game_state;
+    GameState m_previous; // before the last tick
+    AudioQueue *m_audio;  // null when nothing plays sounds
+    uint32_t m_ticks;     // ticks run so far, to tell the audio which events came together
+    Uint64 m_tick_time;
+    uint64_t m_tick_ns;
+    ReplayRecorder *m_recorder; // null when not recording
+    std::vector<FinishedReplay> m_finished_replays;
+    GameAutopilot *m_autopilot; // null when the player steers
+    InputQueue m_input;
+    InputLatency m_latency;
+};
+
+// draws the game as of a snapshot; show() one before the first render
+class GameScene : public IScene
+{
+public:
+    GameScene(SpriteBatch &batch, SDL_Texture *board_cache) noexcept
+        : m_snapshot{}, m_batch{batch}, m_board_cache{board_cache}, m_is_board_cache_valid{}, m_cached_gifts{}, m_cached_houses{}, m_dirty_rects{}, m_is_dirty{true}
+    {
+    }
+    ~GameScene() noexcept override = default;
+    GameScene(const GameScene &) noexcept = delete;
+    GameScene(GameScene &&) noexcept = delete;
+    GameScene operator=(const GameScene &) noexcept = delete;
+    GameScene operator=(GameScene &&) noexcept = delete;
+
+public:
+    void update(double /*dt_sec*/) override
+    {
+    }
+    // while the game runs santa and his bags slide every frame; once it is over
+    // the last frame stands until something asks for it again
+    bool is_dirty() const override { return !m_snapshot->state.game_over || m_is_dirty; }
+    void invalidate() override { m_is_dirty = true; }
+    void render(double alpha) override
+    {
+        m_is_dirty = false;
+        const GameState &state{m_snapshot->state};
+        const GameState &previous{m_snapshot->previous};
+
+        // bring the cached board up to date with the last tick
+        refresh_board_cache();
+
+        // clear the screen to black, then lay the board down in one copy
+        m_batch.clear(0, 0, 0);
+        m_batch.copy(m_board_cache, SDL_Rect{0, 0, LOGICAL_SCREEN_W, LOGICAL_SCREEN_H});
+
+        // render bags, every one sliding from where it was on the last tick
+        for (int i{}; i < state.num_bags; i++)
+        {
+            v2 bag{bag_at(state, i)};
+            v2 prev_bag{i < previous.num_bags ? bag_at(previous, i) : bag};
+            SDL_FRect dst_rect{interpolate_tile(prev_bag, bag, alpha)};
+
+            SDL_Rect src_rect{};
+            src_rect.x = 16;
+            src_rect.y = 1;
+            src_rect.w = TILE_PIXEL_SIZE;
+            src_rect.h = TILE_PIXEL_SIZE;
+
+            m_batch.sprite(src_rect, dst_rect, state.santa_direction == DIRECTION_EAST);
+        }
+
+        // render santa
+        {
+            SDL_FRect dst_rect{interpolate_tile(previous.santa, state.santa, alpha)};
+
+            SDL_Rect src_rect{};
+            src_rect.x = 1;
+            src_rect.y = 1;
+            src_rect.w = TILE_PIXEL_SIZE;
+            src_rect.h = TILE_PIXEL_SIZE;
+
+            m_batch.sprite(src_rect, dst_rect, state.santa_direction == DIRECTION_EAST);
+        }
+
+        // TODO: render ui
+
+        // bags and santa all go out in one draw call
+        m_batch.flush();
+    }
+
+public:
+    // draw this snapshot from now on; it has to stay alive until the next one is shown
+    void show(const GameSnapshot &snapshot) noexcept
+    {
+        m_snapshot = &snapshot;
+        m_is_dirty = true;
+    }
+
+    // the render target was lost (device reset, resize on some backends): redraw it whole
+    void invalidate_board_cache() noexcept { m_is_board_cache_valid = false; }
+
+private:
+    // the board only changes on ticks, and then only on a few tiles: redraw just the
+    // tiles whose gift or house bit flipped since the last refresh
+    void refresh_board_cache()
+    {
+        const Board<MAP_SIDE, MAP_SIDE> &board{m_snapshot->state.board};
+        const uint64_t *gifts{board.mask(TILE_GIFT)};
+        const uint64_t *houses{board.mask(TILE_HOUSE)};
+        size_t words{static_cast<size_t>(board.words())};
+        bool is_full{!m_is_board_cache_valid};
+        if (is_full)
+        {
+            m_cached_gifts.assign(words, 0);
+            m_cached_houses.assign(words, 0);
+        }
+
+        // clear the background under every dirty tile first, so the fills go out as one call
+        m_dirty_rects.clear();
+        for (size_t word{}; word < words; word++)
+        {
+            uint64_t dirty{(gifts[word] ^ m_cached_gifts[word]) | (houses[word] ^ m_cached_houses[word])};
+            for (uint64_t bits{dirty}; bits; bits &= bits - 1)
+            {
+                v2 tile{index_tile(board, static_cast<int>(word) * 64 + std::countr_zero(bits))};
+                m_dirty_rects.push_back(SDL_Rect{tile.col * TILE_PIXEL_SIZE, tile.row * TILE_PIXEL_SIZE, TILE_PIXEL_SIZE, TILE_PIXEL_SIZE});
+            }
+        }
+        if (!is_full && m_dirty_rects.empty())
+        {
+            return;
+        }
+
+        m_batch.set_target(m_board_cache);
+        if (is_full)
+        {
+            // background, palette dark green (bounding boxes)
+            m_batch.fill_rect(SDL_Rect{0, 0, LOGICAL_SCREEN_W, LOGICAL_SCREEN_H}, 31, 50, 36);
+        }
+        else
+        {
+            m_batch.fill_rects(m_dirty_rects, 31, 50, 36);
+        }
+
+        // then draw whatever stands on the dirty tiles now
+        for (size_t word{}; word < words; word++)
+        {
+            uint64_t dirty{(gifts[word] ^ m_cached_gifts[word]) | (houses[word] ^ m_cached_houses[word])};
+            for (uint64_t bits{dirty & (gifts[word] | houses[word])}; bits; bits &= bits - 1)
+            {
+                int shift{std::countr_zero(bits)};
+                v2 tile{index_tile(board, static_cast<int>(word) * 64 + shift)};
+
+                SDL_Rect src_rect{};
+                src_rect.x = (gifts[word] >> shift) & 1 ? 1 : 16;
+                src_rect.y = 16;
+                src_rect.w = TILE_PIXEL_SIZE;
+                src_rect.h = TILE_PIXEL_SIZE;
+
+                m_batch.sprite(src_rect, SDL_Rect{tile.col * TILE_PIXEL_SIZE, tile.row * TILE_PIXEL_SIZE, TILE_PIXEL_SIZE, TILE_PIXEL_SIZE}, false);
+            }
+            m_cached_gifts[word] = gifts[word];
+            m_cached_houses[word] = houses[word];
+        }
+        m_batch.set_target(nullptr);
+        m_is_board_cache_valid = true;
+    }
+
+    // where to draw a sprite that moved from 'from' to 'to' on the last tick;
+    // a step across the edge of the map slides off that edge instead of across the whole map
+    SDL_FRect interpolate_tile(v2 from, v2 to, double alpha) const noexcept
+    {
+        int rows{m_snapshot->state.board.rows()};
+        int cols{m_snapshot->state.board.cols()};
+        int d_row{to.row - from.row};
+        int d_col{to.col - from.col};
+        d_row = d_row > 1 ? d_row - rows : (d_row < -1 ? d_row + rows : d_row);
+        d_col = d_col > 1 ? d_col - cols : (d_col < -1 ? d_col + cols : d_col);
+
+        SDL_FRect rect{};
+        rect.x = static_cast<float>((from.col + d_col * alpha) * TILE_PIXEL_SIZE);
+        rect.y = static_cast<float>((from.row + d_row * alpha) * TILE_PIXEL_SIZE);
+        rect.w = static_cast<float>(TILE_PIXEL_SIZE);
+        rect.h = static_cast<float>(TILE_PIXEL_SIZE);
+        return rect;
+    }
+
+private:
+    const GameSnapshot *m_snapshot;        // the one to draw, set by show()
+    SpriteBatch &m_batch;
+    SDL_Texture *m_board_cache;           // background, gifts and houses as of the last refresh
+    bool m_is_board_cache_valid;           // false until the first refresh, and after the gpu loses it
+    std::vector<uint64_t> m_cached_gifts;  // the gift and house bitboards the cache was drawn from
+    std::vector<uint64_t> m_cached_houses;
+    std::vector<SDL_Rect> m_dirty_rects;   // scratch, kept to reuse its capacity
+    bool m_is_dirty;                       // only matters once the game is over: while it runs something always moves
+};
+
+// what the main thread asks of the simulation thread
+enum SimCommandType : uint8_t
+{
+    SIM_COMMAND_TURN,       // queue the intent's turn
+    SIM_COMMAND_START_GAME, // start a new game, if the last one is over
+};
+
+struct SimCommand
+{
+    SimCommandType type;
+    DirectionIntent intent;
+};
+
+constexpr size_t SIM_COMMAND_CAPACITY{64};
+constexpr int MAX_CATCH_UP_TICKS{4}; // ticks run back to back after a stall before the backlog is dropped
+
+// runs a GameSimulation on a thread of its own at the fixed tick rate, so that
+// nothing the renderer does (a slow present, a dragged window) moves a tick.
+// Commands come in through a lock-free queue; after every tick a snapshot goes
+// out through a triple buffer, and an sdl event of type 'snapshot_event' wakes
+// the main thread up in case it sleeps. Finished replays, and the error that
+// stopped the thread if one did, go out through a mailbox the main thread empties
+class SimulationThread
+{
+public:
+    SimulationThread(GameSimulation &simulation, Uint32 snapshot_event)
+        : m_simulation{simulation}, m_snapshot_event{snapshot_event}, m_snapshots{}, m_commands{}, m_wake_mutex{}, m_wake{}, m_has_commands{}, m_stop{}, m_mail_mutex{}, m_replays{}, m_error{}, m_has_mail{}, m_thread{}
+    {
+        // there is a snapshot to draw before the thread runs
+        publish();
+        m_snapshots.acquire();
+        m_thread = std::thread{[this]() { run(); }};
+    }
+    ~SimulationThread() noexcept
+    {
+        stop();
+    }
+    SimulationThread(const SimulationThread &) noexcept = delete;
+    SimulationThread(SimulationThread &&) noexcept = delete;
+    SimulationThread &operator=(const SimulationThread &) noexcept = delete;
+    SimulationThread &operator=(SimulationThread &&) noexcept = delete;
+
+public:
+    // main thread; a command that does not fit (the simulation stopped keeping up) is dropped
+    void send(const SimCommand &command)
+    {
+        if (m_commands.try_push(command))
+        {
+            {
+                std::lock_guard<std::mutex> lock{m_wake_mutex};
+                m_has_commands = true;
+            }
+            m_wake.notify_one();
+        }
+    }
+
+    // main thread: swap in the newest snapshot, false if there is none since the
+    // last call; snapshot() stays valid until the next call
+    bool update_snapshot() noexcept { return m_snapshots.acquire(); }
+    const GameSnapshot &snapshot() const noexcept { return m_snapshots.front(); }
+
+    // main thread: move the replays finished since the last call to the end of
+    // 'replays', and rethrow the error that stopped the simulation, if one did
+    void take_mail(std::vector<FinishedReplay> &replays)
+    {
+        if (!m_has_mail.load(std::memory_order_acquire))
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock{m_mail_mutex};
+        m_has_mail.store(false, std::memory_order_relaxed);
+        std::move(m_replays.begin(), m_replays.end(), std::back_inserter(replays));
+        m_replays.clear();
+        if (m_error)
+        {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+    // waits for the current tick to finish; the simulation is the caller's again afterwards
+    void stop() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_wake_mutex};
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+private:
+    // an error would end the program from here, so it goes to the main thread
+    // instead, which finds it in the mailbox once the event wakes it up
+    void run() noexcept
+    {
+        try
+        {
+            tick_loop();
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard<std::mutex> lock{m_mail_mutex};
+                m_error = std::current_exception();
+                m_has_mail.store(true, std::memory_order_release);
+            }
+            SDL_Event event{};
+            event.type = m_snapshot_event;
+            SDL_PushEvent(&event);
+        }
+    }
+
+    void tick_loop()
+    {
+        using Clock = std::chrono::steady_clock;
+        const Clock::duration tick_duration{std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>{SEC_PER_TICK})};
+        Clock::time_point next_tick{Clock::now() + tick_duration};
+        for (;;)
+        {
+            // sleep until the next tick or a command; once the game is over only a command changes anything
+            {
+                std::unique_lock<std::mutex> lock{m_wake_mutex};
+                auto is_woken{[this]() { return m_stop || m_has_commands; }};
+                if (m_simulation.state().game_over)
+                {
+                    m_wake.wait(lock, is_woken);
+                }
+                else
+                {
+                    m_wake.wait_until(lock, next_tick, is_woken);
+                }
+                if (m_stop)
+                {
+                    return;
+                }
+                m_has_commands = false;
+            }
+
+            SimCommand command{};
+            while (m_commands.try_pop(command))
+            {
+                switch (command.type)
+                {
+                case SIM_COMMAND_TURN:
+                {
+                    m_simulation.push_input(command.intent);
+                }
+                break;
+                case SIM_COMMAND_START_GAME:
+                {
+                    if (m_simulation.state().game_over)
+                    {
+                        m_simulation.start_game();
+                        next_tick = Clock::now() + tick_duration;
+                        publish();
+                    }
+                }
+                break;
+                default:
+                {
+                    unreachable();
+                }
+                }
+            }
+
+            // run the ticks that are due; after a long stall (a breakpoint, a suspended
+            // machine) give up on the backlog instead of fast forwarding through it
+            int ticks{};
+            while (!m_simulation.state().game_over && Clock::now() >= next_tick && ticks < MAX_CATCH_UP_TICKS)
+            {
+                m_simulation.tick();
+                if (m_simulation.has_finished_replays())
+                {
+                    std::lock_guard<std::mutex> lock{m_mail_mutex};
+                    m_simulation.take_finished_replays(m_replays);
+                    m_has_mail.store(true, std::memory_order_release);
+                }
+                publish();
+                next_tick += tick_duration;
+                ticks++;
+            }
+            if (ticks == MAX_CATCH_UP_TICKS)
+            {
+                next_tick = Clock::now() + tick_duration;
+            }
+        }
+    }
+
+    void publish()
+    {
+        m_simulation.snapshot(m_snapshots.back());
+        m_snapshots.publish();
+        SDL_Event event{};
+        event.type = m_snapshot_event;
+        SDL_PushEvent(&event);
+    }
+
+private:
+    GameSimulation &m_simulation; // the simulation thread's alone while it runs
+    Uint32 m_snapshot_event;
+    TripleBuffer<GameSnapshot> m_snapshots;
+    SpscRing<SimCommand, SIM_COMMAND_CAPACITY> m_commands;
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+    bool m_has_commands; // guarded by m_wake_mutex
+    bool m_stop;         // guarded by m_wake_mutex
+    std::mutex m_mail_mutex;
+    std::vector<FinishedReplay> m_replays; // guarded by m_mail_mutex
+    std::exception_ptr m_error;            // guarded by m_mail_mutex
+    std::atomic<bool> m_has_mail;          // something is in the mailbox
+    std::thread m_thread;
+};
+
+// fnv-1a over the pixels of a frame, row by row (rows may be padded)
+inline uint64_t hash_frame(const SDL_Surface *frame) noexcept
+{
+    uint64_t hash{FNV_OFFSET_BASIS};
+    for (int y{}; y < frame->h; y++)
+    {
+        const Uint32 *row{reinterpret_cast<const Uint32 *>(static_cast<const uint8_t *>(frame->pixels) + y * frame->pitch)};
+        for (int x{}; x < frame->w; x++)
+        {
+            hash = hash_u64(hash, row[x]);
+        }
+    }
+    return hash;
+}
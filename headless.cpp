@@ -0,0 +1,152 @@
+// headless driver: runs many games with a random player (or the autopilot) and no SDL, on every
+// core, as fast as the cpu allows, and reports how many ticks per second it gets
+
+#include "sim.hpp"
+#include "batch.hpp"
+#include "snapshot.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+constexpr int DEFAULT_GAMES{4096};
+constexpr int64_t DEFAULT_TICKS_PER_GAME{10'000};
+
+struct SnapshotOptions
+{
+    std::string load_path; // start the games from this corpus, round robin
+    std::string save_path; // save where every game got to into this corpus
+};
+
+template <typename State>
+static BatchStats run_batch(const State &prototype, int games, int threads, uint64_t seed, int64_t ticks, const SnapshotOptions &snapshots, bool autopilot)
+{
+    BatchSimulator<State> batch{prototype, games, threads, seed, autopilot ? autopilot_player<State> : random_player<State>};
+
+    // snapshots are fixed-layout, so they only exist for fixed-size boards
+    if constexpr (std::is_same_v<State, DynamicGameState>)
+    {
+        if (!snapshots.load_path.empty() || !snapshots.save_path.empty())
+        {
+            error("snapshots are only supported on fixed-size boards");
+        }
+    }
+    else
+    {
+        if (!snapshots.load_path.empty())
+        {
+            using Corpus = SnapshotCorpus<State::BOARD_ROWS, State::BOARD_COLS>;
+            Corpus corpus{snapshots.load_path};
+            if (corpus.count() == 0)
+            {
+                error(std::format("'{}' holds no snapshots", snapshots.load_path));
+            }
+            State state{prototype};
+            for (int i{}; i < games; i++)
+            {
+                load_snapshot(corpus.record(static_cast<size_t>(i) % corpus.count()), state);
+                batch.set_game(i, state);
+            }
+        }
+    }
+
+    BatchStats stats{batch.run(ticks)};
+
+    if constexpr (!std::is_same_v<State, DynamicGameState>)
+    {
+        if (!snapshots.save_path.empty())
+        {
+            SnapshotWriter<State::BOARD_ROWS, State::BOARD_COLS> writer{snapshots.save_path};
+            for (int i{}; i < games; i++)
+            {
+                writer.append(batch.game(i));
+            }
+            writer.close();
+        }
+    }
+
+    return stats;
+}
+
+static int entry(int argc, char **argv)
+{
+    int games{DEFAULT_GAMES};
+    int64_t ticks{DEFAULT_TICKS_PER_GAME};
+    int threads{std::max(1, static_cast<int>(std::thread::hardware_concurrency()))};
+    uint64_t seed{std::random_device{}()};
+    int side{MAP_SIDE};
+    SnapshotOptions snapshots{};
+    bool autopilot{};
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--games" && i + 1 < argc)
+        {
+            games = std::atoi(argv[++i]);
+        }
+        else if (arg == "--ticks" && i + 1 < argc)
+        {
+            ticks = std::atoll(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (arg == "--side" && i + 1 < argc)
+        {
+            side = std::atoi(argv[++i]);
+        }
+        else if (arg == "--load-snapshots" && i + 1 < argc)
+        {
+            snapshots.load_path = argv[++i];
+        }
+        else if (arg == "--save-snapshots" && i + 1 < argc)
+        {
+            snapshots.save_path = argv[++i];
+        }
+        else if (arg == "--autopilot")
+        {
+            autopilot = true;
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            error(std::format("unknown argument '{}' (usage: headless [--games N] [--ticks N] [--threads N] [--side N] [--seed N] [--autopilot] [--load-snapshots FILE] [--save-snapshots FILE])", arg));
+        }
+    }
+
+    // small boards have fixed-size specializations, anything else lives on the heap
+    BatchStats stats{with_board_state<BasicGameState, MAP_SIDE, 16, 32, 64>(side, side, [&](auto prototype) { return run_batch(prototype, games, threads, seed, ticks, snapshots, autopilot); })};
+
+    std::cout << std::format("seed: {}\n", seed);
+    std::cout << std::format("games: {} on {}x{} boards ({} ticks each, {} threads, {} player)\n", games, side, side, ticks, threads, autopilot ? "autopilot" : "random");
+    std::cout << std::format("ticks: {}\n", stats.ticks);
+    std::cout << std::format("games finished: {}\n", stats.games_finished);
+    std::cout << std::format("deliveries: {}\n", stats.deliveries);
+    std::cout << std::format("elapsed: {:.3f} s\n", stats.elapsed_sec);
+    std::cout << std::format("ticks/sec: {:.0f}\n", stats.ticks_per_sec);
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return entry(argc, argv);
+    }
+    catch (const Error &error)
+    {
+        std::cerr << error.what() << "\n";
+    }
+
+    return 1;
+}
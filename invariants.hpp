@@ -0,0 +1,255 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// rule invariants
+// what must hold between any two ticks: the masks split the board into empty,
+// bag, gift and house tiles, the empty count matches, and the trail is a chain
+// of num_bags distinct neighboring tiles starting next to santa that covers
+// exactly the bag tiles. Cheap enough to check after every tick: O(words) for
+// the masks, O(num_bags) for the trail. A swarm keeps the same board, with one
+// such trail per agent, the trails covering the bag tiles between them
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+#include "swarm.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+// 'a' and 'b' share an edge, across the board's edges too
+template <typename BoardT>
+inline bool are_neighbors(const BoardT &board, v2 a, v2 b) noexcept
+{
+    int d_row{std::abs(a.row - b.row)};
+    int d_col{std::abs(a.col - b.col)};
+    bool is_row_step{d_row == 1 || (d_row == board.rows() - 1 && d_row > 0)};
+    bool is_col_step{d_col == 1 || (d_col == board.cols() - 1 && d_col > 0)};
+    return (d_row == 0 && is_col_step) || (d_col == 0 && is_row_step);
+}
+
+// the first invariant the board's masks break, or nullptr: every tile is exactly
+// one of empty, bag, gift or house, and the empty count matches
+template <typename BoardT>
+inline const char *check_board_invariants(const BoardT &board)
+{
+    int tiles{board.rows() * board.cols()};
+    int num_empty{};
+    for (int word{}; word < board.words(); word++)
+    {
+        int bits_in_word{std::min(64, tiles - word * 64)};
+        uint64_t all{bits_in_word == 64 ? ~uint64_t{} : (uint64_t{1} << bits_in_word) - 1};
+        uint64_t empty{board.mask(TILE_EMPTY)[word]};
+        uint64_t bag{board.mask(TILE_BAG)[word]};
+        uint64_t gift{board.mask(TILE_GIFT)[word]};
+        uint64_t house{board.mask(TILE_HOUSE)[word]};
+        if ((empty | bag | gift | house) != all)
+        {
+            return "a tile is none of empty, bag, gift or house";
+        }
+        if ((empty & bag) | (empty & gift) | (empty & house) | (bag & gift) | (bag & house) | (gift & house))
+        {
+            return "a tile is two things at once";
+        }
+        num_empty += std::popcount(empty);
+    }
+    if (num_empty != board.num_empty || fenwick_prefix(board.empty_tree(), board.words()) != num_empty)
+    {
+        return "the empty tile count is out of sync with the board";
+    }
+    return nullptr;
+}
+
+// the first invariant 'state' breaks, or nullptr; the messages are string literals,
+// so failures can be told apart by pointer
+template <int ROWS, int COLS>
+inline const char *check_invariants(const BasicGameState<ROWS, COLS> &state)
+{
+    const Board<ROWS, COLS> &board{state.board};
+    int tiles{board.rows() * board.cols()};
+
+    const char *board_failure{check_board_invariants(board)};
+    if (board_failure)
+    {
+        return board_failure;
+    }
+
+    if (state.santa.row < 0 || state.santa.row >= board.rows() || state.santa.col < 0 || state.santa.col >= board.cols())
+    {
+        return "santa is off the board";
+    }
+    if (state.num_bags < 0 || state.num_bags > state.trail.capacity() || state.trail.head < 0 || (state.num_bags > 0 && state.trail.head >= state.trail.capacity()))
+    {
+        return "the trail ring is out of range";
+    }
+
+    // the trail: bag tiles only, each next to the one ahead of it, none twice, and
+    // every bag tile on it. The tiles seen on it so far live inline on fixed boards,
+    // and are kept (and left clear) between calls on dynamic ones
+    uint64_t inline_seen[ROWS == DYNAMIC_SIDE ? 1 : static_cast<size_t>(board_words(ROWS, COLS))]{};
+    uint64_t *seen{inline_seen};
+    if constexpr (ROWS == DYNAMIC_SIDE)
+    {
+        thread_local std::vector<uint64_t> dynamic_seen{};
+        dynamic_seen.resize(static_cast<size_t>(board.words()));
+        seen = dynamic_seen.data();
+    }
+    const char *failure{};
+    v2 ahead{state.santa};
+    int checked{};
+    for (; checked < state.num_bags && !failure; checked++)
+    {
+        int slot{state.trail.head + checked};
+        slot = slot < state.trail.capacity() ? slot : slot - state.trail.capacity();
+        uint32_t packed{state.trail.slots()[slot]};
+        if (packed >= static_cast<uint32_t>(tiles))
+        {
+            failure = "a trail entry is off the board";
+            break;
+        }
+        int tile{static_cast<int>(packed)};
+        uint64_t bit{uint64_t{1} << (tile % 64)};
+        uint64_t &seen_word{seen[tile / 64]};
+        if ((board.mask(TILE_BAG)[tile / 64] & bit) == 0)
+        {
+            failure = "a trail entry is not a bag tile";
+        }
+        else if (seen_word & bit)
+        {
+            failure = "the trail runs over itself";
+        }
+        v2 here{index_tile(board, tile)};
+        // santa has already walked onto something else when the tick ended the game
+        if (!failure && (checked > 0 || !state.game_over) && !are_neighbors(board, here, ahead))
+        {
+            failure = checked == 0 ? "the first bag is not next to santa" : "the trail is broken";
+        }
+        seen_word |= bit;
+        ahead = here;
+    }
+    for (int word{}; word < board.words() && !failure; word++)
+    {
+        if (seen[word] != board.mask(TILE_BAG)[word])
+        {
+            failure = "a bag tile is not on the trail";
+        }
+    }
+
+    // leave the dynamic 'seen' clear for the next call, touching only the bits that were set
+    if constexpr (ROWS == DYNAMIC_SIDE)
+    {
+        for (int i{}; i < checked; i++)
+        {
+            int slot{state.trail.head + i};
+            slot = slot < state.trail.capacity() ? slot : slot - state.trail.capacity();
+            uint32_t packed{state.trail.slots()[slot]};
+            if (packed < static_cast<uint32_t>(tiles))
+            {
+                seen[packed / 64] &= ~(uint64_t{1} << (packed % 64));
+            }
+        }
+    }
+    if (failure)
+    {
+        return failure;
+    }
+
+    // where santa stands was emptied, unless he just died there
+    int santa{tile_index(board, state.santa)};
+    if (!state.game_over && (board.mask(TILE_EMPTY)[santa / 64] & (uint64_t{1} << (santa % 64))) == 0)
+    {
+        return "santa stands on something";
+    }
+    return nullptr;
+}
+
+// the first invariant 'state' breaks, or nullptr: the board's, every agent on its
+// own empty tile with its bit in 'occupied' and no other bits set, and every
+// trail a chain of distinct bag tiles starting next to its agent, within the
+// agent's ring, the trails covering the bag tiles between them
+template <int ROWS, int COLS>
+inline const char *check_swarm_invariants(const BasicSwarmState<ROWS, COLS> &state)
+{
+    const Board<ROWS, COLS> &board{state.board};
+    int tiles{board.rows() * board.cols()};
+
+    const char *board_failure{check_board_invariants(board)};
+    if (board_failure)
+    {
+        return board_failure;
+    }
+
+    // tiles on some trail so far, and agents' tiles, one bit per tile
+    thread_local std::vector<uint64_t> seen{};
+    thread_local std::vector<uint64_t> stands{};
+    seen.assign(static_cast<size_t>(board.words()), 0);
+    stands.assign(static_cast<size_t>(board.words()), 0);
+    for (size_t i{}; i < state.agent_row.size(); i++)
+    {
+        v2 position{state.agent_row[i], state.agent_col[i]};
+        if (position.row < 0 || position.row >= board.rows() || position.col < 0 || position.col >= board.cols())
+        {
+            return "an agent is off the board";
+        }
+        int here_tile{tile_index(board, position)};
+        if (test_tile_bit(stands, here_tile))
+        {
+            return "two agents stand on the same tile";
+        }
+        set_tile_bit(stands, here_tile, true);
+        if (tile_at_index(board, here_tile) != TILE_EMPTY)
+        {
+            return "an agent stands on something";
+        }
+        if (state.num_bags[i] < 0 || state.num_bags[i] > state.max_bags || state.trail_head[i] < 0 || state.trail_head[i] >= state.max_bags)
+        {
+            return "a trail ring is out of range";
+        }
+
+        v2 ahead{position};
+        for (int bag{}; bag < state.num_bags[i]; bag++)
+        {
+            size_t slot{static_cast<size_t>((state.trail_head[i] + bag) % state.max_bags)};
+            uint32_t packed{state.trail_slots[i * static_cast<size_t>(state.max_bags) + slot]};
+            if (packed >= static_cast<uint32_t>(tiles))
+            {
+                return "a trail entry is off the board";
+            }
+            int tile{static_cast<int>(packed)};
+            if (tile_at_index(board, tile) != TILE_BAG)
+            {
+                return "a trail entry is not a bag tile";
+            }
+            if (test_tile_bit(seen, tile))
+            {
+                return "a bag is on a trail twice";
+            }
+            set_tile_bit(seen, tile, true);
+            v2 here{index_tile(board, tile)};
+            if (!are_neighbors(board, here, ahead))
+            {
+                return bag == 0 ? "the first bag is not next to its agent" : "a trail is broken";
+            }
+            ahead = here;
+        }
+    }
+
+    for (int word{}; word < board.words(); word++)
+    {
+        size_t index{static_cast<size_t>(word)};
+        if (seen[index] != board.mask(TILE_BAG)[word])
+        {
+            return "a bag tile is on no trail";
+        }
+        if (stands[index] != state.occupied[index])
+        {
+            return "the occupied tiles are out of sync with the agents";
+        }
+        if (state.claimed[index] != 0)
+        {
+            return "a claim was left over from the last tick";
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,149 @@
+// asset packer: decodes the game's assets once, offline, into the pack the game
+// maps at startup. Images become rgba32 pixels, sounds become pcm in the format
+// the game opens the mixer with, anything else (the music) is stored as it is
+
+#include "game.hpp"
+#include "asset_pack.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static AssetEntry asset_entry(const std::filesystem::path &path, AssetKind kind)
+{
+    std::string name{path.filename().string()};
+    if (name.size() >= ASSET_NAME_SIZE)
+    {
+        error(std::format("asset name '{}' is longer than {} characters", name, ASSET_NAME_SIZE - 1));
+    }
+    AssetEntry entry{};
+    std::memcpy(entry.name, name.c_str(), name.size());
+    entry.kind = kind;
+    return entry;
+}
+
+static void pack_image(AssetPackWriter &writer, const std::filesystem::path &path)
+{
+    // copy the decoded image into rgba32 without blending it over anything
+    SDL2ExSurface image{path.string().c_str()};
+    SDL2ExSurface rgba{image.Handle()->w, image.Handle()->h};
+    if (SDL_SetSurfaceBlendMode(image.Handle(), SDL_BLENDMODE_NONE) < 0 || SDL_BlitSurface(image.Handle(), nullptr, rgba.Handle(), nullptr) < 0)
+    {
+        error(std::format("failed to convert '{}' to rgba32: {}", path.string(), SDL_GetError()));
+    }
+
+    // rows are stored back to back, without the surface's padding
+    const SDL_Surface *surface{rgba.Handle()};
+    size_t row_size{static_cast<size_t>(surface->w) * 4};
+    std::vector<uint8_t> pixels(row_size * static_cast<size_t>(surface->h));
+    for (int y{}; y < surface->h; y++)
+    {
+        std::memcpy(pixels.data() + static_cast<size_t>(y) * row_size, static_cast<const uint8_t *>(surface->pixels) + y * surface->pitch, row_size);
+    }
+
+    AssetEntry entry{asset_entry(path, ASSET_IMAGE)};
+    entry.width = static_cast<uint32_t>(surface->w);
+    entry.height = static_cast<uint32_t>(surface->h);
+    writer.add(entry, pixels.data(), pixels.size());
+}
+
+static void pack_sound(AssetPackWriter &writer, const std::filesystem::path &path)
+{
+    // the mixer converts what it loads to its own output format
+    SDL2ExChunk chunk{path.string().c_str()};
+    int frequency{};
+    Uint16 format{};
+    int channels{};
+    if (Mix_QuerySpec(&frequency, &format, &channels) == 0)
+    {
+        error(std::format("failed to query the mixer format: {}", Mix_GetError()));
+    }
+
+    AssetEntry entry{asset_entry(path, ASSET_PCM)};
+    entry.frequency = static_cast<uint32_t>(frequency);
+    entry.channels = static_cast<uint16_t>(channels);
+    entry.format = format;
+    writer.add(entry, chunk.Handle()->abuf, chunk.Handle()->alen);
+}
+
+static void pack_blob(AssetPackWriter &writer, const std::filesystem::path &path)
+{
+    std::vector<uint8_t> bytes{read_file(path.string())};
+    writer.add(asset_entry(path, ASSET_BLOB), bytes.data(), bytes.size());
+}
+
+static int entry(int argc, char **argv)
+{
+    std::string dir{"assets"};
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--dir" && i + 1 < argc)
+        {
+            dir = argv[++i];
+        }
+        else
+        {
+            error(std::format("unknown argument '{}' (usage: pack [--dir DIR])", arg));
+        }
+    }
+
+    // decode for the same mixer format the game opens, on a device that plays nowhere
+    SDL_SetHint("SDL_AUDIODRIVER", "dummy");
+    SDL2ExImageHandle sdl2ex_image_handle{};
+    SDL2ExMixerHandle sdl2ex_mixer_handle{};
+
+    std::vector<std::filesystem::path> paths{};
+    for (const std::filesystem::directory_entry &file : std::filesystem::directory_iterator{dir})
+    {
+        if (file.is_regular_file() && file.path().filename() != ASSET_PACK_FILE)
+        {
+            paths.push_back(file.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    AssetPackWriter writer{};
+    for (const std::filesystem::path &path : paths)
+    {
+        std::string extension{path.extension().string()};
+        if (extension == ".png")
+        {
+            pack_image(writer, path);
+        }
+        else if (extension == ".wav")
+        {
+            pack_sound(writer, path);
+        }
+        else
+        {
+            pack_blob(writer, path);
+        }
+        std::cout << std::format("packed {}\n", path.string());
+    }
+
+    std::string pack_path{dir + "/" + ASSET_PACK_FILE};
+    writer.write(pack_path);
+    std::cout << std::format("wrote {} ({} assets, {} bytes)\n", pack_path, paths.size(), std::filesystem::file_size(pack_path));
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return entry(argc, argv);
+    }
+    catch (const Error &error)
+    {
+        std::cerr << error.what() << "\n";
+    }
+
+    return 1;
+}
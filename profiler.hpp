@@ -0,0 +1,205 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// frame profiler
+// scoped timers feed per-phase latency histograms. Build with -DCOZY_PROFILE to
+// turn them on; without it PROFILE_SCOPE expands to nothing and no timer runs.
+// Histograms are log-linear: 8 sub-buckets per power of two of nanoseconds, so
+// every bucket is within 12.5% of the values it holds and recording is O(1)
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+enum ProfilePhase : uint8_t
+{
+    PROFILE_FRAME, // a drawn frame up to its present, the phases below are parts of it
+    PROFILE_EVENTS,
+    PROFILE_UPDATE,
+    PROFILE_SIM,
+    PROFILE_RENDER,
+    PROFILE_PRESENT,
+    PROFILE_PHASE_COUNT,
+};
+
+inline const char *profile_phase_name(ProfilePhase phase)
+{
+    const char *name{};
+    switch (phase)
+    {
+    case PROFILE_FRAME:
+    {
+        name = "frame";
+    }
+    break;
+    case PROFILE_EVENTS:
+    {
+        name = "events";
+    }
+    break;
+    case PROFILE_UPDATE:
+    {
+        name = "update";
+    }
+    break;
+    case PROFILE_SIM:
+    {
+        name = "sim";
+    }
+    break;
+    case PROFILE_RENDER:
+    {
+        name = "render";
+    }
+    break;
+    case PROFILE_PRESENT:
+    {
+        name = "present";
+    }
+    break;
+    case PROFILE_PHASE_COUNT:
+    default:
+    {
+        unreachable();
+    }
+    }
+    return name;
+}
+
+constexpr int HISTOGRAM_SUB_BITS{3};
+constexpr int HISTOGRAM_SUB_BUCKETS{1 << HISTOGRAM_SUB_BITS};
+constexpr int HISTOGRAM_BUCKETS{(64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS};
+
+struct Histogram
+{
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+// values below 8 get a bucket each; above, the top 3 bits under the leading one pick the sub-bucket
+constexpr int histogram_bucket(uint64_t ns) noexcept
+{
+    if (ns < HISTOGRAM_SUB_BUCKETS)
+    {
+        return static_cast<int>(ns);
+    }
+    int msb{static_cast<int>(std::bit_width(ns)) - 1};
+    int sub{static_cast<int>((ns >> (msb - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1))};
+    return (msb - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+// smallest value that falls in a bucket
+constexpr uint64_t histogram_bucket_floor(int bucket) noexcept
+{
+    if (bucket < HISTOGRAM_SUB_BUCKETS)
+    {
+        return static_cast<uint64_t>(bucket);
+    }
+    int msb{bucket / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BITS - 1};
+    uint64_t sub{static_cast<uint64_t>(bucket % HISTOGRAM_SUB_BUCKETS)};
+    return (HISTOGRAM_SUB_BUCKETS + sub) << (msb - HISTOGRAM_SUB_BITS);
+}
+
+static_assert(histogram_bucket(7) == 7 && histogram_bucket(8) == 8 && histogram_bucket(15) == 15 && histogram_bucket(16) == 16);
+static_assert(histogram_bucket(UINT64_MAX) == HISTOGRAM_BUCKETS - 1);
+static_assert(histogram_bucket_floor(histogram_bucket(1000)) <= 1000 && histogram_bucket_floor(histogram_bucket(1000) + 1) > 1000);
+
+inline void histogram_record(Histogram &histogram, uint64_t ns) noexcept
+{
+    histogram.buckets[histogram_bucket(ns)]++;
+    histogram.count++;
+    histogram.total_ns += ns;
+    histogram.max_ns = std::max(histogram.max_ns, ns);
+}
+
+// the value under which a fraction 'p' of the samples fall (upper edge of its bucket, capped by the max)
+inline uint64_t histogram_percentile(const Histogram &histogram, double p) noexcept
+{
+    uint64_t rank{static_cast<uint64_t>(p * static_cast<double>(histogram.count))};
+    uint64_t seen{};
+    for (int bucket{}; bucket < HISTOGRAM_BUCKETS - 1; bucket++)
+    {
+        seen += histogram.buckets[bucket];
+        if (seen > rank)
+        {
+            return std::min(histogram_bucket_floor(bucket + 1) - 1, histogram.max_ns);
+        }
+    }
+    return histogram.max_ns;
+}
+
+struct Profiler
+{
+    Histogram phases[PROFILE_PHASE_COUNT];
+};
+
+// one line per phase with its summary, and one line per non-empty bucket
+inline void write_profile_csv(const Profiler &profiler, const std::string &summary_path, const std::string &histogram_path)
+{
+    std::ofstream summary{summary_path};
+    std::ofstream histogram{histogram_path};
+    summary << "phase,count,mean_us,p50_us,p99_us,max_us\n";
+    histogram << "phase,floor_us,count\n";
+    for (int i{}; i < PROFILE_PHASE_COUNT; i++)
+    {
+        const Histogram &phase{profiler.phases[i]};
+        const char *name{profile_phase_name(static_cast<ProfilePhase>(i))};
+        double mean_ns{phase.count > 0 ? static_cast<double>(phase.total_ns) / static_cast<double>(phase.count) : 0.0};
+        summary << std::format("{},{},{:.3f},{:.3f},{:.3f},{:.3f}\n", name, phase.count, mean_ns / 1000.0, static_cast<double>(histogram_percentile(phase, 0.5)) / 1000.0, static_cast<double>(histogram_percentile(phase, 0.99)) / 1000.0, static_cast<double>(phase.max_ns) / 1000.0);
+        for (int bucket{}; bucket < HISTOGRAM_BUCKETS; bucket++)
+        {
+            if (phase.buckets[bucket] > 0)
+            {
+                histogram << std::format("{},{:.3f},{}\n", name, static_cast<double>(histogram_bucket_floor(bucket)) / 1000.0, phase.buckets[bucket]);
+            }
+        }
+    }
+    if (!summary || !histogram)
+    {
+        error(std::format("failed to write '{}' and '{}'", summary_path, histogram_path));
+    }
+}
+
+#if defined(COZY_PROFILE)
+
+// the game profiles a single thread, so one profiler for the whole program does
+constinit inline Profiler global_profiler{};
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(ProfilePhase phase) noexcept
+        : m_phase{phase}, m_start{std::chrono::steady_clock::now()}
+    {
+    }
+    ~ScopedTimer() noexcept
+    {
+        auto ns{std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count()};
+        histogram_record(global_profiler.phases[m_phase], static_cast<uint64_t>(ns));
+    }
+    ScopedTimer(const ScopedTimer &) noexcept = delete;
+    ScopedTimer(ScopedTimer &&) noexcept = delete;
+    ScopedTimer &operator=(const ScopedTimer &) noexcept = delete;
+    ScopedTimer &operator=(ScopedTimer &&) noexcept = delete;
+
+private:
+    ProfilePhase m_phase;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(phase) ScopedTimer PROFILE_CONCAT(profile_scope_, __LINE__) { phase }
+
+#else
+
+#define PROFILE_SCOPE(phase) static_cast<void>(0)
+
+#endif
@@ -0,0 +1,128 @@
+// replay verifier: plays back recorded games headless, as fast as the cpu
+// allows, and checks that every one of them ends on the recorded state hash
+
+#include "sim.hpp"
+#include "replay.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ReplayResult
+{
+    bool ok;
+    int64_t ticks;
+    std::string message;
+};
+
+static ReplayResult verify_replay(const std::string &path)
+{
+    ReplayResult result{};
+    try
+    {
+        std::vector<uint8_t> bytes{read_file(path)};
+        Replay replay{parse_replay(bytes.data(), bytes.size())};
+        result.ticks = static_cast<int64_t>(replay.directions.size());
+
+        result.ok = with_board_state<BasicGameState, MAP_SIDE>(replay.rows, replay.cols, [&replay](auto state) { return play_replay(replay, state); });
+        if (!result.ok)
+        {
+            result.message = "final state hash does not match";
+        }
+    }
+    catch (const Error &e)
+    {
+        result.ok = false;
+        result.message = e.what();
+    }
+    return result;
+}
+
+static int entry(int argc, char **argv)
+{
+    int threads{std::max(1, static_cast<int>(std::thread::hardware_concurrency()))};
+    std::vector<std::string> paths{};
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--threads" && i + 1 < argc)
+        {
+            threads = std::atoi(argv[++i]);
+        }
+        else if (std::filesystem::is_directory(arg))
+        {
+            // every replay below the directory
+            for (const std::filesystem::directory_entry &file : std::filesystem::recursive_directory_iterator{arg})
+            {
+                if (file.is_regular_file() && file.path().extension() == REPLAY_EXTENSION)
+                {
+                    paths.push_back(file.path().string());
+                }
+            }
+        }
+        else
+        {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty())
+    {
+        error("no replays given (usage: replay [--threads N] <file.czr | directory>...)");
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<ReplayResult> results(paths.size());
+    auto start{std::chrono::steady_clock::now()};
+    {
+        ThreadPool pool{threads};
+        for (size_t i{}; i < paths.size(); i++)
+        {
+            pool.submit([&results, &paths, i]() { results[i] = verify_replay(paths[i]); });
+        }
+        pool.wait_idle();
+    }
+    auto end{std::chrono::steady_clock::now()};
+
+    int64_t ticks{};
+    int failed{};
+    for (size_t i{}; i < paths.size(); i++)
+    {
+        ticks += results[i].ticks;
+        if (!results[i].ok)
+        {
+            failed++;
+            std::cout << std::format("FAIL {}: {}\n", paths[i], results[i].message);
+        }
+    }
+
+    double elapsed_sec{std::chrono::duration<double>(end - start).count()};
+    std::cout << std::format("replays: {} ({} failed)\n", paths.size(), failed);
+    std::cout << std::format("ticks: {}\n", ticks);
+    std::cout << std::format("elapsed: {:.3f} s\n", elapsed_sec);
+    std::cout << std::format("ticks/sec: {:.0f}\n", static_cast<double>(ticks) / elapsed_sec);
+
+    return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return entry(argc, argv);
+    }
+    catch (const Error &error)
+    {
+        std::cerr << error.what() << "\n";
+    }
+
+    return 1;
+}
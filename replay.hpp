@@ -0,0 +1,224 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// input replays
+// a replay is the generator state a game started from plus santa's direction
+// on every tick, which is everything the rules need to play the game again.
+// File layout (little endian):
+//   "CZRP" | u32 version | u16 rows | u16 cols | u64 rng state | u64 rng increment |
+//   varint ticks | u64 final state hash | varint changes | changes...
+// where every change is varint((ticks since the previous change << 2) | direction)
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+#include "file_io.hpp"
+
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+constexpr uint8_t REPLAY_MAGIC[4]{'C', 'Z', 'R', 'P'};
+constexpr uint32_t REPLAY_VERSION{1};
+constexpr uint8_t NO_DIRECTION{0xff};
+constexpr const char *REPLAY_EXTENSION{".czr"};
+constexpr uint64_t MAX_REPLAY_TICKS{uint64_t{1} << 31}; // keeps corrupted files from asking for absurd allocations
+
+struct Replay
+{
+    int rows;
+    int cols;
+    Rng rng;
+    uint64_t final_hash;
+    std::vector<Direction> directions; // one per tick
+};
+
+inline void put_varint(std::vector<uint8_t> &bytes, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        bytes.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+
+inline void put_le(std::vector<uint8_t> &bytes, uint64_t value, int size)
+{
+    for (int i{}; i < size; i++)
+    {
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// reads from a byte buffer and reports truncated or malformed files as errors
+class ByteReader
+{
+public:
+    ByteReader(const uint8_t *data, size_t size) noexcept
+        : m_data{data}, m_size{size}, m_pos{}
+    {
+    }
+
+public:
+    uint64_t le(int size)
+    {
+        if (m_size - m_pos < static_cast<size_t>(size))
+        {
+            error("unexpected end of file");
+        }
+        uint64_t value{};
+        for (int i{}; i < size; i++)
+        {
+            value |= static_cast<uint64_t>(m_data[m_pos++]) << (8 * i);
+        }
+        return value;
+    }
+    uint64_t varint()
+    {
+        uint64_t value{};
+        for (int shift{}; shift < 64; shift += 7)
+        {
+            uint64_t byte{le(1)};
+            value |= (byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+            {
+                return value;
+            }
+        }
+        error("varint too long");
+    }
+    bool done() const noexcept { return m_pos == m_size; }
+
+private:
+    const uint8_t *m_data;
+    size_t m_size;
+    size_t m_pos;
+};
+
+// hooks into a running game: begin() when it starts, record_tick() right before
+// every update_game_state, finish() once it is over
+class ReplayRecorder
+{
+public:
+    template <int ROWS, int COLS>
+    void begin(const BasicGameState<ROWS, COLS> &state)
+    {
+        m_rows = state.board.rows();
+        m_cols = state.board.cols();
+        m_rng = state.rng;
+        m_ticks = 0;
+        m_last_change = 0;
+        m_last_direction = NO_DIRECTION;
+        m_changes.clear();
+        m_num_changes = 0;
+    }
+    void record_tick(Direction direction)
+    {
+        if (direction != m_last_direction)
+        {
+            put_varint(m_changes, (static_cast<uint64_t>(m_ticks - m_last_change) << 2) | direction);
+            m_num_changes++;
+            m_last_change = m_ticks;
+            m_last_direction = direction;
+        }
+        m_ticks++;
+    }
+    const Rng &start_rng() const noexcept { return m_rng; }
+    template <int ROWS, int COLS>
+    std::vector<uint8_t> finish(const BasicGameState<ROWS, COLS> &state) const
+    {
+        std::vector<uint8_t> bytes{};
+        bytes.insert(bytes.end(), std::begin(REPLAY_MAGIC), std::end(REPLAY_MAGIC));
+        put_le(bytes, REPLAY_VERSION, 4);
+        put_le(bytes, static_cast<uint64_t>(m_rows), 2);
+        put_le(bytes, static_cast<uint64_t>(m_cols), 2);
+        put_le(bytes, m_rng.state, 8);
+        put_le(bytes, m_rng.increment, 8);
+        put_varint(bytes, static_cast<uint64_t>(m_ticks));
+        put_le(bytes, hash_game_state(state), 8);
+        put_varint(bytes, m_num_changes);
+        bytes.insert(bytes.end(), m_changes.begin(), m_changes.end());
+        return bytes;
+    }
+
+private:
+    int m_rows{};
+    int m_cols{};
+    Rng m_rng{};
+    int64_t m_ticks{};
+    int64_t m_last_change{};
+    uint8_t m_last_direction{NO_DIRECTION};
+    std::vector<uint8_t> m_changes{};
+    uint64_t m_num_changes{};
+};
+
+inline Replay parse_replay(const uint8_t *data, size_t size)
+{
+    ByteReader reader{data, size};
+    for (uint8_t magic : REPLAY_MAGIC)
+    {
+        if (reader.le(1) != magic)
+        {
+            error("not a replay file");
+        }
+    }
+    uint64_t version{reader.le(4)};
+    if (version != REPLAY_VERSION)
+    {
+        error(std::format("unsupported replay version {} (expected {})", version, REPLAY_VERSION));
+    }
+
+    Replay replay{};
+    replay.rows = static_cast<int>(reader.le(2));
+    replay.cols = static_cast<int>(reader.le(2));
+    replay.rng.state = reader.le(8);
+    replay.rng.increment = reader.le(8);
+    uint64_t ticks{reader.varint()};
+    replay.final_hash = reader.le(8);
+    uint64_t num_changes{reader.varint()};
+    if (ticks > MAX_REPLAY_TICKS)
+    {
+        error(std::format("implausible tick count {}", ticks));
+    }
+
+    // expand the changes back into one direction per tick
+    replay.directions.reserve(ticks);
+    uint8_t direction{NO_DIRECTION};
+    for (uint64_t i{}; i < num_changes; i++)
+    {
+        uint64_t change{reader.varint()};
+        uint64_t run{change >> 2};
+        bool is_first{i == 0};
+        if (is_first != (run == 0) || run > ticks - replay.directions.size())
+        {
+            error("corrupted direction changes");
+        }
+        replay.directions.insert(replay.directions.end(), run, static_cast<Direction>(direction));
+        direction = static_cast<uint8_t>(change & 3);
+    }
+    if (num_changes > 0)
+    {
+        replay.directions.insert(replay.directions.end(), ticks - replay.directions.size(), static_cast<Direction>(direction));
+    }
+    if (replay.directions.size() != ticks || !reader.done())
+    {
+        error("corrupted replay");
+    }
+
+    return replay;
+}
+
+// play a replay back on a fresh state; true if it ends exactly where it was recorded
+template <int ROWS, int COLS>
+inline bool play_replay(const Replay &replay, BasicGameState<ROWS, COLS> &state)
+{
+    state.rng = replay.rng;
+    init_game_state(state);
+    for (Direction direction : replay.directions)
+    {
+        state.santa_direction = direction;
+        update_game_state(state);
+    }
+    return hash_game_state(state) == replay.final_hash;
+}
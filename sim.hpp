@@ -0,0 +1,914 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// simulation core
+// this header must not depend on SDL: it is shared by the game and by the
+// headless tools, which are built without linking SDL at all
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <format>
+#include <initializer_list>
+#include <stacktrace>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+constexpr int MAP_SIDE{8}; // side of the board the game is played on
+constexpr int DYNAMIC_SIDE{0}; // board dimension chosen at runtime
+constexpr double SPAWN_TIME_SEC_START{2.0};
+constexpr double SPAWN_TIME_DIFFICULTY_COEFFICIENT{0.01};
+constexpr double MIN_SPAWN_TIME_SEC{0.5};
+constexpr double SEC_PER_TICK{0.5};
+
+#define error(msg) \
+    throw Error { __FILE__, __LINE__, (msg) }
+
+#define unreachable() error("unreachable code path")
+
+class Error : public std::runtime_error
+{
+public:
+    Error(const char *file, int line, const std::string &message)
+        : std::runtime_error{std::format("{}({}): {}\n{}", file, line, message, std::to_string(std::stacktrace::current(1)))}
+    {
+    }
+};
+
+enum TileType : uint8_t
+{
+    TILE_EMPTY,
+    TILE_BAG,
+    TILE_GIFT,
+    TILE_HOUSE,
+};
+
+struct v2
+{
+    int row;
+    int col;
+};
+
+enum Direction : uint8_t
+{
+    DIRECTION_NORTH,
+    DIRECTION_SOUTH,
+    DIRECTION_WEST,
+    DIRECTION_EAST,
+};
+
+// one step in each direction, indexed by Direction
+constexpr v2 DIRECTION_DELTA[4]{
+    {-1, 0}, // DIRECTION_NORTH
+    {1, 0},  // DIRECTION_SOUTH
+    {0, -1}, // DIRECTION_WEST
+    {0, 1},  // DIRECTION_EAST
+};
+
+// things that happened during a single tick; the rules only report them,
+// it is up to the caller to play sounds, draw effects or just ignore them
+enum GameEvent : uint8_t
+{
+    GAME_EVENT_STEP,
+    GAME_EVENT_GIFT,
+    GAME_EVENT_HOUSE,
+    GAME_EVENT_HURT,
+    GAME_EVENT_SPAWN,
+};
+
+// what walking onto each tile type does to santa, his bags and the tile;
+// update_game_state looks the rules up here instead of switching on the tile
+struct TileRule
+{
+    bool is_blocked; // the game is over
+    bool needs_bags; // the game is over, and santa is hurt, if he has no bags
+    bool takes_bag;  // the last bag is delivered
+    bool gives_bag;  // a new first bag joins the trail where santa was
+    GameEvent event; // reported unless the game ended
+};
+
+constexpr TileRule TILE_RULES[4]{
+    {false, false, false, false, GAME_EVENT_STEP}, // TILE_EMPTY
+    {true, false, false, false, GAME_EVENT_STEP},  // TILE_BAG
+    {false, false, false, true, GAME_EVENT_GIFT},  // TILE_GIFT
+    {false, true, true, false, GAME_EVENT_HOUSE},  // TILE_HOUSE
+};
+
+// a tick emits at most one event for the tile santa lands on plus one spawn
+constexpr int MAX_GAME_EVENTS_PER_TICK{2};
+
+struct GameEvents
+{
+    GameEvent items[MAX_GAME_EVENTS_PER_TICK];
+    int count;
+};
+
+constexpr void push_game_event(GameEvents &events, GameEvent event)
+{
+    if (events.count >= MAX_GAME_EVENTS_PER_TICK)
+    {
+        error(std::format("too many events in a single tick (max is {})", MAX_GAME_EVENTS_PER_TICK));
+    }
+    events.items[events.count++] = event;
+}
+
+// pcg32 (https://www.pcg-random.org): 16 bytes of state, cheap to copy and to
+// step, and every game owns one so games can run on separate threads
+struct Rng
+{
+    uint64_t state;
+    uint64_t increment; // selects the stream, always odd
+};
+
+constexpr uint32_t next_u32(Rng &rng) noexcept
+{
+    uint64_t old_state{rng.state};
+    rng.state = old_state * 6364136223846793005ULL + rng.increment;
+    uint32_t xorshifted{static_cast<uint32_t>(((old_state >> 18u) ^ old_state) >> 27u)};
+    uint32_t rotation{static_cast<uint32_t>(old_state >> 59u)};
+    return std::rotr(xorshifted, static_cast<int>(rotation));
+}
+
+// same seed and stream, same sequence; different streams are independent
+constexpr void seed_rng(Rng &rng, uint64_t seed, uint64_t stream = 0) noexcept
+{
+    rng.state = 0;
+    rng.increment = (stream << 1u) | 1u;
+    next_u32(rng);
+    rng.state += seed;
+    next_u32(rng);
+}
+
+constexpr int random_int(Rng &rng, int lo, int hi) noexcept
+{
+    // from 'lo' included to 'hi' included, without modulo bias (lemire's method)
+    uint32_t range{static_cast<uint32_t>(static_cast<int64_t>(hi) - lo) + 1};
+    uint64_t product{static_cast<uint64_t>(next_u32(rng)) * range};
+    uint32_t low{static_cast<uint32_t>(product)};
+    if (low < range)
+    {
+        uint32_t threshold{(0u - range) % range};
+        while (low < threshold)
+        {
+            product = static_cast<uint64_t>(next_u32(rng)) * range;
+            low = static_cast<uint32_t>(product);
+        }
+    }
+    return static_cast<int>(static_cast<int64_t>(lo) + static_cast<int64_t>(product >> 32u));
+}
+
+// index of the n-th (counting from 0) set bit of 'mask'; 'mask' must have more than n bits set
+constexpr int select_bit(uint64_t mask, int n) noexcept
+{
+#if defined(__BMI2__)
+    // the intrinsic can't run at compile time, where the search below does the job
+    if (!std::is_constant_evaluated())
+    {
+        return std::countr_zero(_pdep_u64(uint64_t{1} << n, mask));
+    }
+#endif
+    // binary search on the popcount of the lower half of the remaining window
+    int pos{};
+    for (int width{32}; width > 0; width /= 2)
+    {
+        uint64_t low{(mask >> pos) & ((uint64_t{1} << width) - 1)};
+        int count{std::popcount(low)};
+        if (n >= count)
+        {
+            n -= count;
+            pos += width;
+        }
+    }
+    return pos;
+}
+
+// fenwick tree over per-word bit counts ('tree' is 1-based, 'size' words long);
+// it lets large boards count and pick empty tiles in O(log words)
+constexpr void fenwick_add(int32_t *tree, int size, int word, int32_t delta) noexcept
+{
+    for (int i{word + 1}; i <= size; i += i & -i)
+    {
+        tree[i] += delta;
+    }
+}
+
+// number of set bits in words [0, word)
+constexpr int32_t fenwick_prefix(const int32_t *tree, int word) noexcept
+{
+    int32_t sum{};
+    for (int i{word}; i > 0; i -= i & -i)
+    {
+        sum += tree[i];
+    }
+    return sum;
+}
+
+// word holding the rank-th (counting from 0) set bit; 'rank' is left relative to that word
+constexpr int fenwick_find(const int32_t *tree, int size, int &rank) noexcept
+{
+    int pos{};
+    for (int step{static_cast<int>(std::bit_floor(static_cast<unsigned>(size)))}; step > 0; step /= 2)
+    {
+        if (pos + step <= size && tree[pos + step] <= rank)
+        {
+            pos += step;
+            rank -= tree[pos];
+        }
+    }
+    return pos;
+}
+
+// ----------------------------------------------------------------------------
+// board storage
+// one occupancy bitboard per TileType (tile (row, col) is bit row * cols + col)
+// and a fenwick tree of empty tiles per word.
+// Board<ROWS, COLS> keeps everything inline, for small boards known at compile
+// time; Board<DYNAMIC_SIDE, DYNAMIC_SIDE> keeps it on the heap, for large boards
+// whose size is only known at runtime
+// ----------------------------------------------------------------------------
+
+constexpr int board_words(int rows, int cols) noexcept
+{
+    return (rows * cols + 63) / 64;
+}
+
+template <typename BoardT>
+constexpr void clear_board(BoardT &board) noexcept;
+
+// where a coordinate one step off either edge of a SIDE long axis wraps back to,
+// indexed by the coordinate plus one, so that a step needs neither a compare nor
+// a division
+template <int SIDE>
+struct WrapTable
+{
+    constexpr WrapTable() noexcept
+        : coords{}
+    {
+        for (int i{}; i < SIDE + 2; i++)
+        {
+            coords[i] = i == 0 ? SIDE - 1 : (i == SIDE + 1 ? 0 : i - 1);
+        }
+    }
+
+    int coords[static_cast<size_t>(SIDE) + 2];
+};
+
+template <int ROWS, int COLS>
+struct Board
+{
+    static_assert(ROWS > 0 && COLS > 0, "fixed boards need both dimensions, use DYNAMIC_SIDE for both otherwise");
+    static constexpr int WORDS{board_words(ROWS, COLS)};
+    static constexpr WrapTable<ROWS> ROW_WRAP{};
+    static constexpr WrapTable<COLS> COL_WRAP{};
+
+    constexpr Board() noexcept { clear_board(*this); }
+
+    constexpr int rows() const noexcept { return ROWS; }
+    constexpr int cols() const noexcept { return COLS; }
+    constexpr int words() const noexcept { return WORDS; }
+    constexpr int wrap_row(int row) const noexcept { return ROW_WRAP.coords[row + 1]; }
+    constexpr int wrap_col(int col) const noexcept { return COL_WRAP.coords[col + 1]; }
+    constexpr uint64_t *mask(TileType type) noexcept { return tiles[type]; }
+    constexpr const uint64_t *mask(TileType type) const noexcept { return tiles[type]; }
+    constexpr int32_t *empty_tree() noexcept { return empty_per_word; }
+    constexpr const int32_t *empty_tree() const noexcept { return empty_per_word; }
+
+    uint64_t tiles[4][static_cast<size_t>(WORDS)];
+    int32_t empty_per_word[static_cast<size_t>(WORDS) + 1];
+    int num_empty;
+};
+
+template <>
+struct Board<DYNAMIC_SIDE, DYNAMIC_SIDE>
+{
+    Board(int board_rows, int board_cols)
+        : m_rows{board_rows}, m_cols{board_cols}, m_tiles{}, m_empty_tree{}, num_empty{}
+    {
+        if (board_rows <= 0 || board_cols <= 0 || static_cast<int64_t>(board_rows) * board_cols > INT32_MAX)
+        {
+            error(std::format("invalid board size {}x{}", board_rows, board_cols));
+        }
+        size_t words{static_cast<size_t>(board_words(board_rows, board_cols))};
+        m_tiles.resize(4 * words);
+        m_empty_tree.resize(words + 1);
+        clear_board(*this);
+    }
+    Board()
+        : Board{MAP_SIDE, MAP_SIDE}
+    {
+    }
+
+    int rows() const noexcept { return m_rows; }
+    int cols() const noexcept { return m_cols; }
+    int words() const noexcept { return board_words(m_rows, m_cols); }
+    // one step off either edge at most, as for the fixed boards' tables
+    int wrap_row(int row) const noexcept { return row < 0 ? m_rows - 1 : (row < m_rows ? row : 0); }
+    int wrap_col(int col) const noexcept { return col < 0 ? m_cols - 1 : (col < m_cols ? col : 0); }
+    uint64_t *mask(TileType type) noexcept { return m_tiles.data() + static_cast<size_t>(type) * static_cast<size_t>(words()); }
+    const uint64_t *mask(TileType type) const noexcept { return m_tiles.data() + static_cast<size_t>(type) * static_cast<size_t>(words()); }
+    int32_t *empty_tree() noexcept { return m_empty_tree.data(); }
+    const int32_t *empty_tree() const noexcept { return m_empty_tree.data(); }
+
+private:
+    int m_rows;
+    int m_cols;
+    std::vector<uint64_t> m_tiles;
+    std::vector<int32_t> m_empty_tree;
+
+public:
+    int num_empty;
+};
+
+template <typename BoardT>
+constexpr void clear_board(BoardT &board) noexcept
+{
+    int tiles{board.rows() * board.cols()};
+    int words{board.words()};
+    for (int word{}; word < words; word++)
+    {
+        int bits_in_word{std::min(64, tiles - word * 64)};
+        board.mask(TILE_EMPTY)[word] = bits_in_word == 64 ? ~uint64_t{} : (uint64_t{1} << bits_in_word) - 1;
+        board.mask(TILE_BAG)[word] = 0;
+        board.mask(TILE_GIFT)[word] = 0;
+        board.mask(TILE_HOUSE)[word] = 0;
+    }
+
+    // build the fenwick tree bottom up in O(words)
+    int32_t *tree{board.empty_tree()};
+    tree[0] = 0;
+    for (int i{1}; i <= words; i++)
+    {
+        tree[i] = std::popcount(board.mask(TILE_EMPTY)[i - 1]);
+    }
+    for (int i{1}; i <= words; i++)
+    {
+        int parent{i + (i & -i)};
+        if (parent <= words)
+        {
+            tree[parent] += tree[i];
+        }
+    }
+
+    board.num_empty = tiles;
+}
+
+template <typename BoardT>
+constexpr int tile_index(const BoardT &board, v2 tile) noexcept
+{
+    return tile.row * board.cols() + tile.col;
+}
+
+template <typename BoardT>
+constexpr v2 index_tile(const BoardT &board, int index) noexcept
+{
+    return v2{index / board.cols(), index % board.cols()};
+}
+
+template <typename BoardT>
+constexpr TileType tile_at_index(const BoardT &board, int index) noexcept
+{
+    int word{index / 64};
+    int shift{index % 64};
+    uint64_t is_bag{(board.mask(TILE_BAG)[word] >> shift) & 1};
+    uint64_t is_gift{(board.mask(TILE_GIFT)[word] >> shift) & 1};
+    uint64_t is_house{(board.mask(TILE_HOUSE)[word] >> shift) & 1};
+    return static_cast<TileType>(is_bag * TILE_BAG + is_gift * TILE_GIFT + is_house * TILE_HOUSE);
+}
+
+template <typename BoardT>
+constexpr TileType tile_at(const BoardT &board, v2 tile) noexcept
+{
+    return tile_at_index(board, tile_index(board, tile));
+}
+
+template <typename BoardT>
+constexpr void set_tile_at_index(BoardT &board, int index, TileType type) noexcept
+{
+    int word{index / 64};
+    uint64_t bit{uint64_t{1} << (index % 64)};
+    bool was_empty{(board.mask(TILE_EMPTY)[word] & bit) != 0};
+    board.mask(TILE_EMPTY)[word] &= ~bit;
+    board.mask(TILE_BAG)[word] &= ~bit;
+    board.mask(TILE_GIFT)[word] &= ~bit;
+    board.mask(TILE_HOUSE)[word] &= ~bit;
+    board.mask(type)[word] |= bit;
+
+    // keep the empty tile counts in sync
+    int delta{(type == TILE_EMPTY) - was_empty};
+    if (delta != 0)
+    {
+        fenwick_add(board.empty_tree(), board.words(), word, delta);
+        board.num_empty += delta;
+    }
+}
+
+template <typename BoardT>
+constexpr void set_tile(BoardT &board, v2 tile, TileType type) noexcept
+{
+    set_tile_at_index(board, tile_index(board, tile), type);
+}
+
+// uniformly pick an empty tile other than 'excluded'; false if there is none
+template <typename BoardT>
+constexpr bool pick_empty_tile(const BoardT &board, v2 excluded, Rng &rng, v2 &picked)
+{
+    const uint64_t *empty{board.mask(TILE_EMPTY)};
+    int excluded_index{tile_index(board, excluded)};
+    int excluded_word{excluded_index / 64};
+    uint64_t excluded_bit{uint64_t{1} << (excluded_index % 64)};
+    bool is_excluded_empty{(empty[excluded_word] & excluded_bit) != 0};
+
+    int count{board.num_empty - is_excluded_empty};
+    if (count <= 0)
+    {
+        return false;
+    }
+
+    // draw a rank among the candidates, then skip over the excluded tile if it is empty
+    int rank{random_int(rng, 0, count - 1)};
+    if (is_excluded_empty)
+    {
+        int excluded_rank{fenwick_prefix(board.empty_tree(), excluded_word) + std::popcount(empty[excluded_word] & (excluded_bit - 1))};
+        if (rank >= excluded_rank)
+        {
+            rank++;
+        }
+    }
+    int word{fenwick_find(board.empty_tree(), board.words(), rank)};
+    picked = index_tile(board, word * 64 + select_bit(empty[word], rank));
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// bag trail
+// ring buffer of packed tile indices, from the first bag (the one right behind
+// santa) to the last one. A trail can't hold more bags than there are tiles,
+// so fixed boards reserve that much inline; dynamic boards grow on demand
+// ----------------------------------------------------------------------------
+
+template <int ROWS, int COLS>
+struct BagTrail
+{
+    static constexpr int CAPACITY{ROWS * COLS};
+
+    constexpr int capacity() const noexcept { return CAPACITY; }
+    constexpr uint32_t *slots() noexcept { return m_slots; }
+    constexpr const uint32_t *slots() const noexcept { return m_slots; }
+    constexpr void grow(int /*length*/) noexcept {}
+
+    uint32_t m_slots[static_cast<size_t>(CAPACITY)];
+    int head;
+};
+
+template <>
+struct BagTrail<DYNAMIC_SIDE, DYNAMIC_SIDE>
+{
+    int capacity() const noexcept { return static_cast<int>(m_slots.size()); }
+    uint32_t *slots() noexcept { return m_slots.data(); }
+    const uint32_t *slots() const noexcept { return m_slots.data(); }
+
+    // make room for one more bag, unrolling the ring so that it starts at slot 0
+    void grow(int length)
+    {
+        if (length < capacity())
+        {
+            return;
+        }
+        std::vector<uint32_t> slots(std::max<size_t>(64, 2 * m_slots.size()));
+        for (int i{}; i < length; i++)
+        {
+            slots[static_cast<size_t>(i)] = m_slots[static_cast<size_t>((head + i) % capacity())];
+        }
+        m_slots = std::move(slots);
+        head = 0;
+    }
+
+    std::vector<uint32_t> m_slots;
+    int head;
+};
+
+#if 0
+static constexpr const char *direction_to_str(Direction direction) noexcept
+{
+    const char *str{""};
+    switch (direction)
+    {
+    case DIRECTION_NORTH:
+    {
+        str = "NORTH";
+    }
+    break;
+    case DIRECTION_SOUTH:
+    {
+        str = "SOUTH";
+    }
+    break;
+    case DIRECTION_WEST:
+    {
+        str = "WEST";
+    }
+    break;
+    case DIRECTION_EAST:
+    {
+        str = "EAST";
+    }
+    break;
+    default:
+    {
+    }
+    }
+    return str;
+}
+#endif
+
+constexpr Direction opposite_direction(Direction direction)
+{
+    Direction opposite{};
+    switch (direction)
+    {
+    case DIRECTION_NORTH:
+    {
+        opposite = DIRECTION_SOUTH;
+    }
+    break;
+    case DIRECTION_SOUTH:
+    {
+        opposite = DIRECTION_NORTH;
+    }
+    break;
+    case DIRECTION_WEST:
+    {
+        opposite = DIRECTION_EAST;
+    }
+    break;
+    case DIRECTION_EAST:
+    {
+        opposite = DIRECTION_WEST;
+    }
+    break;
+    default:
+    {
+        unreachable();
+    }
+    }
+    return opposite;
+}
+
+template <int ROWS, int COLS>
+struct BasicGameState
+{
+    static constexpr int BOARD_ROWS{ROWS}; // DYNAMIC_SIDE for boards sized at runtime
+    static constexpr int BOARD_COLS{COLS};
+
+    Board<ROWS, COLS> board{};
+    BagTrail<ROWS, COLS> trail{};
+    Direction santa_direction;
+    v2 santa;
+    int num_bags; // length of the trail
+    bool game_over{true};
+    bool exit;
+    double spawn_time_sec{SPAWN_TIME_SEC_START};
+    double spawn_timer{};
+    Rng rng{}; // seed with seed_rng; init_game_state leaves it alone
+};
+
+using GameState = BasicGameState<MAP_SIDE, MAP_SIDE>;
+using DynamicGameState = BasicGameState<DYNAMIC_SIDE, DYNAMIC_SIDE>;
+
+// call 'f' with a new StateT for a rows x cols board: the fixed-size specialization
+// when the board is square with one of SIDES, otherwise one that lives on the heap.
+// StateT is BasicGameState or any state templated on the board size the same way
+template <template <int, int> typename StateT, int SIDE, int... SIDES, typename F>
+inline decltype(auto) with_board_state(int rows, int cols, F &&f)
+{
+    if (rows == SIDE && cols == SIDE)
+    {
+        return f(StateT<SIDE, SIDE>{});
+    }
+    if constexpr (sizeof...(SIDES) > 0)
+    {
+        return with_board_state<StateT, SIDES...>(rows, cols, std::forward<F>(f));
+    }
+    else
+    {
+        StateT<DYNAMIC_SIDE, DYNAMIC_SIDE> state{};
+        state.board = Board<DYNAMIC_SIDE, DYNAMIC_SIDE>{rows, cols};
+        return f(std::move(state));
+    }
+}
+
+// the i-th bag behind santa, counting from 0 (the caller keeps i below num_bags)
+template <int ROWS, int COLS>
+constexpr v2 bag_at(const BasicGameState<ROWS, COLS> &state, int i) noexcept
+{
+    int slot{state.trail.head + i};
+    slot = slot < state.trail.capacity() ? slot : slot - state.trail.capacity();
+    return index_tile(state.board, static_cast<int>(state.trail.slots()[slot]));
+}
+
+// the bag right behind santa, or (-1, -1) without bags
+template <int ROWS, int COLS>
+constexpr v2 first_bag(const BasicGameState<ROWS, COLS> &state) noexcept
+{
+    return state.num_bags > 0 ? bag_at(state, 0) : v2{-1, -1};
+}
+
+// the bag at the end of the trail, or (-1, -1) without bags
+template <int ROWS, int COLS>
+constexpr v2 last_bag(const BasicGameState<ROWS, COLS> &state) noexcept
+{
+    return state.num_bags > 0 ? bag_at(state, state.num_bags - 1) : v2{-1, -1};
+}
+
+// put a new first bag at the front of the trail (the caller places the tile)
+template <int ROWS, int COLS>
+constexpr void push_first_bag(BasicGameState<ROWS, COLS> &state, v2 bag)
+{
+    state.trail.grow(state.num_bags);
+    state.trail.head = state.trail.head > 0 ? state.trail.head - 1 : state.trail.capacity() - 1;
+    state.trail.slots()[state.trail.head] = static_cast<uint32_t>(tile_index(state.board, bag));
+    state.num_bags++;
+}
+
+// take the last bag off the trail and return its tile index (the caller clears the tile)
+template <int ROWS, int COLS>
+constexpr int pop_last_bag(BasicGameState<ROWS, COLS> &state) noexcept
+{
+    state.num_bags--;
+    int tail{state.trail.head + state.num_bags};
+    tail = tail < state.trail.capacity() ? tail : tail - state.trail.capacity();
+    return static_cast<int>(state.trail.slots()[tail]);
+}
+
+// start a new game on the same board; the exit request and the generator are kept
+template <int ROWS, int COLS>
+constexpr void init_game_state(BasicGameState<ROWS, COLS> &state)
+{
+    clear_board(state.board);
+
+    // santa starts in the middle of the map, facing west like his sprite
+    state.santa_direction = DIRECTION_WEST;
+    state.santa = v2{state.board.rows() / 2, state.board.cols() / 2};
+    state.trail.head = 0;
+    state.num_bags = 0;
+    state.game_over = false;
+    state.spawn_time_sec = SPAWN_TIME_SEC_START;
+    state.spawn_timer = 0.0;
+}
+
+// santa cannot turn back while carrying bags, otherwise he would walk into them and die
+template <int ROWS, int COLS>
+constexpr bool can_turn(const BasicGameState<ROWS, COLS> &state, Direction direction)
+{
+    return !(direction == opposite_direction(state.santa_direction) && state.num_bags > 0);
+}
+
+// advance the game by exactly one tick and report what happened
+template <int ROWS, int COLS>
+constexpr GameEvents update_game_state(BasicGameState<ROWS, COLS> &state)
+{
+    GameEvents events{};
+    Board<ROWS, COLS> &board{state.board};
+
+    // save old santa position for later
+    v2 old_santa{state.santa};
+
+    // move santa, wrapping around the edges
+    if (state.santa_direction > DIRECTION_EAST)
+    {
+        unreachable();
+    }
+    v2 delta{DIRECTION_DELTA[state.santa_direction]};
+    state.santa = v2{board.wrap_row(state.santa.row + delta.row), board.wrap_col(state.santa.col + delta.col)};
+
+    // run the rule of the tile santa is on
+    TileType tile{tile_at(board, state.santa)};
+    const TileRule &rule{TILE_RULES[tile]};
+    if (rule.is_blocked)
+    {
+        state.game_over = true;
+    }
+    else if (rule.needs_bags && state.num_bags <= 0)
+    {
+        state.game_over = true;
+
+        push_game_event(events, GAME_EVENT_HURT);
+    }
+    else
+    {
+        // a gift is picked up, a house delivered to
+        if (tile != TILE_EMPTY)
+        {
+            set_tile(board, state.santa, TILE_EMPTY);
+        }
+        // deliver the last bag
+        if (rule.takes_bag)
+        {
+            set_tile_at_index(board, pop_last_bag(state), TILE_EMPTY);
+        }
+        // a gift becomes a new first bag where santa was; otherwise the bags
+        // left follow santa: a new first bag there and the last bag goes away
+        bool is_following{!rule.gives_bag && state.num_bags > 0};
+        if (rule.gives_bag || is_following)
+        {
+            set_tile(board, old_santa, TILE_BAG);
+            push_first_bag(state, old_santa);
+        }
+        if (is_following)
+        {
+            set_tile_at_index(board, pop_last_bag(state), TILE_EMPTY);
+        }
+
+        push_game_event(events, rule.event);
+    }
+
+    // when spawn timer sets off, either spawn a gift or a house
+    if (state.spawn_timer >= state.spawn_time_sec)
+    {
+        // spawning logic: pick a random empty tile, santa's tile excluded
+        v2 random_tile{};
+        if (pick_empty_tile(board, state.santa, state.rng, random_tile))
+        {
+            // spawn either a gift or a house randomly
+            set_tile(board, random_tile, random_int(state.rng, 1, 100) <= 50 ? TILE_GIFT : TILE_HOUSE);
+
+            push_game_event(events, GAME_EVENT_SPAWN);
+        }
+
+        // make spawn time a little shorter (to make game harder)
+        state.spawn_time_sec -= SPAWN_TIME_DIFFICULTY_COEFFICIENT * state.spawn_time_sec;
+        // make sure spawn time doesn't go below the fixed minimum
+        state.spawn_time_sec = std::max(state.spawn_time_sec, MIN_SPAWN_TIME_SEC);
+        // reset timer
+        state.spawn_timer = 0.0;
+    }
+
+    // the spawn timer runs on simulation time, so that a tick means the same
+    // thing no matter how fast the caller is driving the game
+    state.spawn_timer += SEC_PER_TICK;
+
+    return events;
+}
+
+// fnv-1a over everything that decides how the game goes on from here
+constexpr uint64_t FNV_OFFSET_BASIS{14695981039346656037ULL};
+constexpr uint64_t FNV_PRIME{1099511628211ULL};
+
+constexpr uint64_t hash_u64(uint64_t hash, uint64_t value) noexcept
+{
+    for (int i{}; i < 8; i++)
+    {
+        hash ^= (value >> (8 * i)) & 0xff;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+template <int ROWS, int COLS>
+constexpr uint64_t hash_game_state(const BasicGameState<ROWS, COLS> &state) noexcept
+{
+    const Board<ROWS, COLS> &board{state.board};
+    uint64_t hash{FNV_OFFSET_BASIS};
+    hash = hash_u64(hash, static_cast<uint64_t>(board.rows()));
+    hash = hash_u64(hash, static_cast<uint64_t>(board.cols()));
+    for (TileType type : {TILE_BAG, TILE_GIFT, TILE_HOUSE})
+    {
+        for (int word{}; word < board.words(); word++)
+        {
+            hash = hash_u64(hash, board.mask(type)[word]);
+        }
+    }
+    // the trail from first to last bag, wherever it sits in the ring
+    for (int i{}; i < state.num_bags; i++)
+    {
+        hash = hash_u64(hash, state.trail.slots()[(state.trail.head + i) % state.trail.capacity()]);
+    }
+    hash = hash_u64(hash, state.santa_direction);
+    hash = hash_u64(hash, static_cast<uint64_t>(state.santa.row));
+    hash = hash_u64(hash, static_cast<uint64_t>(state.santa.col));
+    hash = hash_u64(hash, static_cast<uint64_t>(state.num_bags));
+    hash = hash_u64(hash, state.game_over);
+    hash = hash_u64(hash, std::bit_cast<uint64_t>(state.spawn_time_sec));
+    hash = hash_u64(hash, std::bit_cast<uint64_t>(state.spawn_timer));
+    hash = hash_u64(hash, state.rng.state);
+    hash = hash_u64(hash, state.rng.increment);
+    return hash;
+}
+
+// ----------------------------------------------------------------------------
+// scripted games
+// the rules are constexpr, so the compiler plays these short games with
+// hand-placed tiles and checks how they end: a change to the rules that breaks
+// one of them does not build. Spawns are held off unless asked for, so that
+// only the placed tiles are on the board
+// ----------------------------------------------------------------------------
+
+struct ScriptedTile
+{
+    v2 tile;
+    TileType type;
+};
+
+struct ScriptedGame
+{
+    GameState state;
+    int events[GAME_EVENT_SPAWN + 1]; // how many of each GameEvent
+};
+
+// a new game seeded with 'seed', 'tiles' placed, then 'moves' played (one of
+// N, S, W or E per tick) until they run out or the game ends
+constexpr ScriptedGame play_script(uint64_t seed, bool is_spawning, std::initializer_list<ScriptedTile> tiles, const char *moves)
+{
+    ScriptedGame game{};
+    seed_rng(game.state.rng, seed);
+    init_game_state(game.state);
+    if (!is_spawning)
+    {
+        game.state.spawn_time_sec = 1e9;
+    }
+    for (const ScriptedTile &tile : tiles)
+    {
+        set_tile(game.state.board, tile.tile, tile.type);
+    }
+    for (const char *move{moves}; *move != '\0' && !game.state.game_over; move++)
+    {
+        switch (*move)
+        {
+        case 'N':
+        {
+            game.state.santa_direction = DIRECTION_NORTH;
+        }
+        break;
+        case 'S':
+        {
+            game.state.santa_direction = DIRECTION_SOUTH;
+        }
+        break;
+        case 'W':
+        {
+            game.state.santa_direction = DIRECTION_WEST;
+        }
+        break;
+        case 'E':
+        {
+            game.state.santa_direction = DIRECTION_EAST;
+        }
+        break;
+        default:
+        {
+            unreachable();
+        }
+        }
+        GameEvents events{update_game_state(game.state)};
+        for (int e{}; e < events.count; e++)
+        {
+            game.events[events.items[e]]++;
+        }
+    }
+    return game;
+}
+
+// santa starts at (4, 4) facing west; a lap in any direction brings him back
+static_assert([] {
+    ScriptedGame across{play_script(1, false, {}, "WWWWWWWW")};
+    ScriptedGame down{play_script(1, false, {}, "SSSSSSSS")};
+    return across.state.santa.row == 4 && across.state.santa.col == 4 && down.state.santa.row == 4 && down.state.santa.col == 4 && !across.state.game_over && across.events[GAME_EVENT_STEP] == 8 && across.state.board.num_empty == MAP_SIDE * MAP_SIDE;
+}());
+
+// a gift turns into a bag behind santa, which follows him across the edge
+static_assert([] {
+    ScriptedGame game{play_script(1, false, {{{4, 3}, TILE_GIFT}}, "WWWWW")};
+    v2 bag{first_bag(game.state)};
+    return game.events[GAME_EVENT_GIFT] == 1 && game.state.num_bags == 1 && game.state.santa.col == 7 && bag.row == 4 && bag.col == 0 && tile_at(game.state.board, bag) == TILE_BAG && game.state.board.num_empty == MAP_SIDE * MAP_SIDE - 1;
+}());
+
+// a house takes the last bag, and the one left keeps following
+static_assert([] {
+    ScriptedGame game{play_script(1, false, {{{4, 3}, TILE_GIFT}, {{4, 2}, TILE_GIFT}, {{3, 2}, TILE_HOUSE}}, "WWNN")};
+    v2 bag{first_bag(game.state)};
+    return game.events[GAME_EVENT_HOUSE] == 1 && game.state.num_bags == 1 && game.state.santa.row == 2 && game.state.santa.col == 2 && bag.row == 3 && bag.col == 2 && game.state.board.num_empty == MAP_SIDE * MAP_SIDE - 1;
+}());
+
+// walking back onto a bag ends the game, and so does a house without bags
+static_assert([] {
+    ScriptedGame back{play_script(1, false, {{{4, 3}, TILE_GIFT}}, "WEW")};
+    ScriptedGame house{play_script(1, false, {{{4, 3}, TILE_HOUSE}}, "WW")};
+    return back.state.game_over && back.events[GAME_EVENT_STEP] == 0 && back.events[GAME_EVENT_HURT] == 0 && house.state.game_over && house.events[GAME_EVENT_HURT] == 1 && house.state.santa.col == 3;
+}());
+
+// the first spawn comes on the fifth tick, on a tile of its own
+static_assert([] {
+    ScriptedGame before{play_script(1, true, {}, "WWWW")};
+    ScriptedGame after{play_script(1, true, {}, "WWWWW")};
+    const Board<MAP_SIDE, MAP_SIDE> &board{after.state.board};
+    int spawned{std::popcount(board.mask(TILE_GIFT)[0] | board.mask(TILE_HOUSE)[0])};
+    return before.events[GAME_EVENT_SPAWN] == 0 && after.events[GAME_EVENT_SPAWN] == 1 && spawned == 1 && board.num_empty == MAP_SIDE * MAP_SIDE - 1 && tile_at(board, after.state.santa) == TILE_EMPTY;
+}());
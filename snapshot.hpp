@@ -0,0 +1,255 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// state snapshots
+// a snapshot corpus is one file holding many game states of the same board
+// size, in a fixed little endian layout:
+//   SnapshotHeader | SnapshotRecord<ROWS, COLS> * count
+// records are fixed size and 8 byte aligned, so a memory-mapped corpus is read
+// in place: nothing is parsed or copied until a record is loaded into a state
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+#include "file_io.hpp"
+#include "invariants.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+
+static_assert(std::endian::native == std::endian::little, "snapshots are stored little endian and mapped as they are");
+
+constexpr uint8_t SNAPSHOT_MAGIC[4]{'C', 'Z', 'S', 'S'};
+constexpr uint32_t SNAPSHOT_VERSION{1};
+
+struct SnapshotHeader
+{
+    uint8_t magic[4];
+    uint32_t version;
+    uint16_t rows;
+    uint16_t cols;
+    uint32_t record_size;
+    uint64_t count;
+    uint64_t reserved;
+};
+static_assert(sizeof(SnapshotHeader) == 32);
+
+template <int ROWS, int COLS>
+struct SnapshotRecord
+{
+    static constexpr size_t WORDS{static_cast<size_t>(Board<ROWS, COLS>::WORDS)};
+    static constexpr size_t TILES{static_cast<size_t>(ROWS) * static_cast<size_t>(COLS)};
+
+    uint64_t bags[WORDS];
+    uint64_t gifts[WORDS];
+    uint64_t houses[WORDS];
+    uint64_t rng_state;
+    uint64_t rng_increment;
+    double spawn_time_sec;
+    double spawn_timer;
+    int32_t santa_row;
+    int32_t santa_col;
+    int32_t num_bags;
+    uint8_t santa_direction;
+    uint8_t game_over;
+    uint8_t padding[2];
+    uint32_t trail[TILES + TILES % 2]; // tile indices from the first to the last bag, num_bags of them are used (rounded up to keep 8 byte alignment)
+};
+
+template <int ROWS, int COLS>
+inline SnapshotRecord<ROWS, COLS> save_snapshot(const BasicGameState<ROWS, COLS> &state) noexcept
+{
+    static_assert(std::is_trivially_copyable_v<SnapshotRecord<ROWS, COLS>> && sizeof(SnapshotRecord<ROWS, COLS>) % 8 == 0);
+
+    const Board<ROWS, COLS> &board{state.board};
+    SnapshotRecord<ROWS, COLS> record{};
+    std::memcpy(record.bags, board.mask(TILE_BAG), sizeof(record.bags));
+    std::memcpy(record.gifts, board.mask(TILE_GIFT), sizeof(record.gifts));
+    std::memcpy(record.houses, board.mask(TILE_HOUSE), sizeof(record.houses));
+    record.rng_state = state.rng.state;
+    record.rng_increment = state.rng.increment;
+    record.spawn_time_sec = state.spawn_time_sec;
+    record.spawn_timer = state.spawn_timer;
+    record.santa_row = state.santa.row;
+    record.santa_col = state.santa.col;
+    record.num_bags = state.num_bags;
+    record.santa_direction = state.santa_direction;
+    record.game_over = state.game_over;
+    for (int i{}; i < state.num_bags; i++)
+    {
+        record.trail[i] = state.trail.slots()[(state.trail.head + i) % state.trail.capacity()];
+    }
+    return record;
+}
+
+// restore a state from a record; the exit request of 'state' is left alone. A
+// record that does not load into a state the rules could have produced (a tile
+// in two masks, a broken trail, santa on an item, timers that are not times) is
+// rejected, and 'state' is left half loaded
+template <int ROWS, int COLS>
+inline void load_snapshot(const SnapshotRecord<ROWS, COLS> &record, BasicGameState<ROWS, COLS> &state)
+{
+    constexpr size_t tiles{SnapshotRecord<ROWS, COLS>::TILES};
+    bool is_santa_on_board{record.santa_row >= 0 && record.santa_row < ROWS && record.santa_col >= 0 && record.santa_col < COLS};
+    bool are_timers_valid{std::isfinite(record.spawn_time_sec) && record.spawn_time_sec > 0.0 && std::isfinite(record.spawn_timer) && record.spawn_timer >= 0.0};
+    if (record.num_bags < 0 || static_cast<size_t>(record.num_bags) > tiles || record.santa_direction > DIRECTION_EAST || !is_santa_on_board || (record.rng_increment & 1) == 0 || !are_timers_valid)
+    {
+        error("corrupted snapshot record");
+    }
+
+    Board<ROWS, COLS> &board{state.board};
+    clear_board(board);
+    for (int word{}; word < board.words(); word++)
+    {
+        for (uint64_t bits{record.bags[word] | record.gifts[word] | record.houses[word]}; bits; bits &= bits - 1)
+        {
+            int shift{std::countr_zero(bits)};
+            uint64_t bit{uint64_t{1} << shift};
+            int tile{word * 64 + shift};
+            if (static_cast<size_t>(tile) >= tiles)
+            {
+                error("corrupted snapshot record");
+            }
+            TileType type{(record.bags[word] & bit) ? TILE_BAG : (record.gifts[word] & bit) ? TILE_GIFT : TILE_HOUSE};
+            set_tile_at_index(board, tile, type);
+        }
+    }
+    state.trail.head = 0;
+    for (int i{}; i < record.num_bags; i++)
+    {
+        state.trail.slots()[i] = record.trail[i];
+    }
+    state.num_bags = record.num_bags;
+    state.santa = v2{record.santa_row, record.santa_col};
+    state.santa_direction = static_cast<Direction>(record.santa_direction);
+    state.game_over = record.game_over != 0;
+    state.spawn_time_sec = record.spawn_time_sec;
+    state.spawn_timer = record.spawn_timer;
+    state.rng.state = record.rng_state;
+    state.rng.increment = record.rng_increment;
+
+    // a tile in two masks was loaded as one of them, and the masks no longer match the record's
+    SnapshotRecord<ROWS, COLS> loaded{save_snapshot(state)};
+    bool are_masks_equal{std::memcmp(loaded.bags, record.bags, sizeof(record.bags)) == 0 && std::memcmp(loaded.gifts, record.gifts, sizeof(record.gifts)) == 0 && std::memcmp(loaded.houses, record.houses, sizeof(record.houses)) == 0};
+    if (!are_masks_equal || check_invariants(state) != nullptr)
+    {
+        error("corrupted snapshot record");
+    }
+}
+
+// appends records to a new corpus file; the header is completed on close()
+template <int ROWS, int COLS>
+class SnapshotWriter
+{
+public:
+    SnapshotWriter(const std::string &path)
+        : m_file{path, std::ios::binary | std::ios::trunc}, m_path{path}, m_count{}
+    {
+        if (!m_file)
+        {
+            error(std::format("failed to create snapshot corpus '{}'", path));
+        }
+        write_header();
+    }
+    ~SnapshotWriter() noexcept = default;
+    SnapshotWriter(const SnapshotWriter &) noexcept = delete;
+    SnapshotWriter(SnapshotWriter &&) noexcept = delete;
+    SnapshotWriter &operator=(const SnapshotWriter &) noexcept = delete;
+    SnapshotWriter &operator=(SnapshotWriter &&) noexcept = delete;
+
+public:
+    void append(const BasicGameState<ROWS, COLS> &state)
+    {
+        SnapshotRecord<ROWS, COLS> record{save_snapshot(state)};
+        m_file.write(reinterpret_cast<const char *>(&record), sizeof(record));
+        m_count++;
+    }
+    void close()
+    {
+        m_file.seekp(0);
+        write_header();
+        m_file.close();
+        if (!m_file)
+        {
+            error(std::format("failed to write snapshot corpus '{}'", m_path));
+        }
+    }
+
+private:
+    void write_header()
+    {
+        SnapshotHeader header{};
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.rows = ROWS;
+        header.cols = COLS;
+        header.record_size = sizeof(SnapshotRecord<ROWS, COLS>);
+        header.count = m_count;
+        m_file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+
+private:
+    std::ofstream m_file;
+    std::string m_path;
+    uint64_t m_count;
+};
+
+// a memory-mapped corpus; records are handed out in place
+template <int ROWS, int COLS>
+class SnapshotCorpus
+{
+public:
+    SnapshotCorpus(const std::string &path) : m_file{path}, m_count{}
+    {
+        if (m_file.size() < sizeof(SnapshotHeader))
+        {
+            error(std::format("'{}' is not a snapshot corpus", path));
+        }
+        const SnapshotHeader &header{*reinterpret_cast<const SnapshotHeader *>(m_file.data())};
+        if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+        {
+            error(std::format("'{}' is not a snapshot corpus", path));
+        }
+        if (header.version != SNAPSHOT_VERSION)
+        {
+            error(std::format("'{}' has snapshot version {} (expected {})", path, header.version, SNAPSHOT_VERSION));
+        }
+        if (header.rows != ROWS || header.cols != COLS || header.record_size != sizeof(SnapshotRecord<ROWS, COLS>))
+        {
+            error(std::format("'{}' holds {}x{} snapshots, expected {}x{}", path, header.rows, header.cols, ROWS, COLS));
+        }
+        if ((m_file.size() - sizeof(SnapshotHeader)) / header.record_size < header.count)
+        {
+            error(std::format("'{}' is truncated", path));
+        }
+        m_count = header.count;
+    }
+
+public:
+    size_t count() const noexcept { return m_count; }
+    const SnapshotRecord<ROWS, COLS> &record(size_t index) const noexcept
+    {
+        const uint8_t *records{m_file.data() + sizeof(SnapshotHeader)};
+        return *reinterpret_cast<const SnapshotRecord<ROWS, COLS> *>(records + index * sizeof(SnapshotRecord<ROWS, COLS>));
+    }
+
+private:
+    MappedFile m_file;
+    size_t m_count;
+};
+
+// read the board size of a corpus without mapping it, to pick the right specialization
+inline v2 snapshot_corpus_size(const std::string &path)
+{
+    std::ifstream file{path, std::ios::binary};
+    SnapshotHeader header{};
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) || std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+    {
+        error(std::format("'{}' is not a snapshot corpus", path));
+    }
+    return v2{header.rows, header.cols};
+}
@@ -0,0 +1,133 @@
+// solver driver: plays one seed with the solver, on every core, to find out how
+// many deliveries the seed allows, and reports how fast it searched. The game it
+// played can be saved as a replay, for the replay tool to check
+
+#include "sim.hpp"
+#include "replay.hpp"
+#include "solver.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+constexpr int DEFAULT_SOLVER_HORIZON{10};
+constexpr int64_t DEFAULT_SOLVER_TICKS{2'000};
+constexpr int DEFAULT_TABLE_BITS{22}; // 64 MiB
+
+struct SolveOptions
+{
+    uint64_t seed;
+    int horizon;
+    int64_t max_ticks; // stop here if the game is not over yet
+    int threads;
+    int table_bits;
+    std::string save_path;
+};
+
+template <typename State>
+static void solve(State state, const SolveOptions &options)
+{
+    using SolverT = Solver<State::BOARD_ROWS, State::BOARD_COLS>;
+    SolverT solver{state, options.threads, options.table_bits, options.horizon};
+
+    seed_rng(state.rng, options.seed);
+    init_game_state(state);
+    ReplayRecorder recorder{};
+    recorder.begin(state);
+    int64_t ticks{};
+    int64_t deliveries{};
+    while (!state.game_over && ticks < options.max_ticks)
+    {
+        state.santa_direction = solver.best_direction(state);
+        recorder.record_tick(state.santa_direction);
+        GameEvents events{update_game_state(state)};
+        for (int e{}; e < events.count; e++)
+        {
+            if (events.items[e] == GAME_EVENT_HOUSE)
+            {
+                deliveries++;
+            }
+        }
+        ticks++;
+    }
+    if (!options.save_path.empty())
+    {
+        write_file(options.save_path, recorder.finish(state));
+    }
+
+    SolverStats stats{solver.stats()};
+    std::cout << std::format("seed: {}\n", options.seed);
+    std::cout << std::format("board: {}x{}, horizon {} ticks, {} threads, {} table entries\n", state.board.rows(), state.board.cols(), options.horizon, options.threads, solver.table_size());
+    std::cout << std::format("deliveries: {}\n", deliveries);
+    std::cout << std::format("ticks: {} ({})\n", ticks, state.game_over ? "game over" : "still going");
+    std::cout << std::format("state: {} bytes per clone\n", sizeof(State));
+    std::cout << std::format("nodes: {}\n", stats.nodes);
+    std::cout << std::format("table hits: {:.1f}%\n", stats.table_probes > 0 ? static_cast<double>(stats.table_hits) * 100.0 / static_cast<double>(stats.table_probes) : 0.0);
+    std::cout << std::format("elapsed: {:.3f} s\n", stats.elapsed_sec);
+    std::cout << std::format("nodes/sec: {:.0f}\n", static_cast<double>(stats.nodes) / stats.elapsed_sec);
+}
+
+static int entry(int argc, char **argv)
+{
+    SolveOptions options{std::random_device{}(), DEFAULT_SOLVER_HORIZON, DEFAULT_SOLVER_TICKS, std::max(1, static_cast<int>(std::thread::hardware_concurrency())), DEFAULT_TABLE_BITS, {}};
+    int side{MAP_SIDE};
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--seed" && i + 1 < argc)
+        {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--horizon" && i + 1 < argc)
+        {
+            options.horizon = std::atoi(argv[++i]);
+        }
+        else if (arg == "--ticks" && i + 1 < argc)
+        {
+            options.max_ticks = std::atoll(argv[++i]);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            options.threads = std::atoi(argv[++i]);
+        }
+        else if (arg == "--table-bits" && i + 1 < argc)
+        {
+            options.table_bits = std::atoi(argv[++i]);
+        }
+        else if (arg == "--side" && i + 1 < argc)
+        {
+            side = std::atoi(argv[++i]);
+        }
+        else if (arg == "--save" && i + 1 < argc)
+        {
+            options.save_path = argv[++i];
+        }
+        else
+        {
+            error(std::format("unknown argument '{}' (usage: solve [--seed N] [--horizon N] [--ticks N] [--threads N] [--table-bits N] [--side N] [--save FILE])", arg));
+        }
+    }
+
+    with_board_state<BasicGameState, MAP_SIDE>(side, side, [&options](auto prototype) { solve(prototype, options); });
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return entry(argc, argv);
+    }
+    catch (const Error &error)
+    {
+        std::cerr << error.what() << "\n";
+    }
+
+    return 1;
+}
@@ -0,0 +1,234 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// solver
+// plays a seed as well as it can, to find out how good a score the seed allows.
+// The rules and the generator are deterministic, so santa's directions are the
+// only choices: every tick it searches every sequence of directions over the
+// next 'horizon' ticks, exhaustively, and takes the first step of the best one.
+// A sequence is worth its deliveries, then the ticks it survives. The tree is
+// split a few ticks down into tasks for a thread pool, and states reached
+// along different sequences are only searched once, through a transposition
+// table keyed by zobrist hashes the search keeps up to date tick by tick
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+#include "thread_pool.hpp"
+#include "transposition_table.hpp"
+#include "zobrist.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <vector>
+
+constexpr uint32_t SOLVER_DELIVERY_VALUE{1u << 16}; // a delivery outweighs any number of ticks survived within a horizon
+constexpr int MAX_SOLVER_HORIZON{64};
+constexpr int SOLVER_TASKS_PER_THREAD{8}; // split the tree into this many subtrees per thread, for stealing to even out
+
+struct SolverStats
+{
+    int64_t nodes; // ticks simulated
+    int64_t table_probes;
+    int64_t table_hits;
+    double elapsed_sec;
+};
+
+template <int ROWS, int COLS>
+class Solver
+{
+public:
+    using State = BasicGameState<ROWS, COLS>;
+
+public:
+    // 'prototype' picks the board size
+    Solver(const State &prototype, int num_threads, int table_bits, int horizon)
+        : m_keys{prototype}, m_table{table_bits}, m_pool{num_threads}, m_horizon{horizon}, m_branches{}, m_next_branches{}, m_values{}, m_nodes{}, m_table_probes{}, m_table_hits{}, m_elapsed_sec{}
+    {
+        if (horizon <= 0 || horizon > MAX_SOLVER_HORIZON)
+        {
+            error(std::format("solver horizon must be 1 to {} ticks (got {})", MAX_SOLVER_HORIZON, horizon));
+        }
+    }
+    ~Solver() noexcept = default;
+    Solver(const Solver &) noexcept = delete;
+    Solver(Solver &&) noexcept = delete;
+    Solver &operator=(const Solver &) noexcept = delete;
+    Solver &operator=(Solver &&) noexcept = delete;
+
+public:
+    // the direction to take on the next tick; keeps going straight unless turning is better
+    Direction best_direction(const State &state)
+    {
+        auto start{std::chrono::steady_clock::now()};
+
+        // the first few ticks, breadth first, until there are enough subtrees to go around
+        m_branches.clear();
+        m_branches.push_back(Branch{state, m_keys.hash(state), state.santa_direction, 0, 0, false});
+        size_t wanted{static_cast<size_t>(m_pool.size() * SOLVER_TASKS_PER_THREAD)};
+        int depth{};
+        int64_t nodes{};
+        while (m_branches.size() < wanted && depth < m_horizon)
+        {
+            m_next_branches.clear();
+            for (const Branch &branch : m_branches)
+            {
+                if (branch.is_done)
+                {
+                    m_next_branches.push_back(branch);
+                    continue;
+                }
+                for (int d{DIRECTION_NORTH}; d <= DIRECTION_EAST; d++)
+                {
+                    Direction direction{static_cast<Direction>(d)};
+                    if (!can_turn(branch.state, direction))
+                    {
+                        continue;
+                    }
+                    Branch child{branch.state, 0, depth == 0 ? direction : branch.first, depth + 1, branch.value, false};
+                    child.state.santa_direction = direction;
+                    child.value += tick_value(update_game_state(child.state), child.state);
+                    nodes++;
+                    child.is_done = child.state.game_over || child.depth == m_horizon;
+                    if (!child.is_done)
+                    {
+                        child.hash = m_keys.step(branch.hash, branch.state, child.state);
+                    }
+                    m_next_branches.push_back(child);
+                }
+            }
+            std::swap(m_branches, m_next_branches);
+            depth++;
+        }
+        m_nodes.fetch_add(nodes, std::memory_order_relaxed);
+
+        // search the rest of every subtree on the pool
+        m_values.assign(m_branches.size(), 0);
+        for (size_t i{}; i < m_branches.size(); i++)
+        {
+            const Branch &branch{m_branches[i]};
+            if (branch.is_done)
+            {
+                m_values[i] = branch.value;
+                continue;
+            }
+            m_pool.submit([this, i]() {
+                SolverStats stats{};
+                const Branch &subtree{m_branches[i]};
+                m_values[i] = subtree.value + search(subtree.state, subtree.hash, m_horizon - subtree.depth, stats);
+                m_nodes.fetch_add(stats.nodes, std::memory_order_relaxed);
+                m_table_probes.fetch_add(stats.table_probes, std::memory_order_relaxed);
+                m_table_hits.fetch_add(stats.table_hits, std::memory_order_relaxed);
+            });
+        }
+        m_pool.wait_idle();
+
+        // the best first step; going straight wins ties, so santa does not wander for nothing
+        Direction best{state.santa_direction};
+        uint32_t best_value{};
+        bool has_best{};
+        for (size_t i{}; i < m_branches.size(); i++)
+        {
+            Direction first{m_branches[i].first};
+            bool is_better{!has_best || m_values[i] > best_value || (m_values[i] == best_value && first == state.santa_direction)};
+            if (is_better)
+            {
+                best = first;
+                best_value = m_values[i];
+                has_best = true;
+            }
+        }
+
+        m_elapsed_sec += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return best;
+    }
+
+    SolverStats stats() const noexcept
+    {
+        return SolverStats{m_nodes.load(), m_table_probes.load(), m_table_hits.load(), m_elapsed_sec};
+    }
+    size_t table_size() const noexcept { return m_table.size(); }
+
+private:
+    struct Branch
+    {
+        State state;
+        uint64_t hash;   // zobrist hash of state, unless is_done
+        Direction first; // the first step taken to get here
+        int depth;
+        uint32_t value; // of the ticks so far
+        bool is_done;   // game over or at the horizon
+    };
+
+private:
+    static uint32_t tick_value(const GameEvents &events, const State &state) noexcept
+    {
+        uint32_t value{state.game_over ? 0u : 1u};
+        for (int e{}; e < events.count; e++)
+        {
+            if (events.items[e] == GAME_EVENT_HOUSE)
+            {
+                value += SOLVER_DELIVERY_VALUE;
+            }
+        }
+        return value;
+    }
+
+    // the zobrist hash covers the board, santa and the trail; what is left decides
+    // the spawns to come, and is folded in here where it can't be kept incrementally
+    static uint64_t table_key(uint64_t hash, const State &state) noexcept
+    {
+        uint64_t spawns{mix_u64(state.rng.state) ^ mix_u64(std::bit_cast<uint64_t>(state.spawn_timer) + std::bit_cast<uint64_t>(state.spawn_time_sec))};
+        return hash ^ mix_u64(spawns);
+    }
+
+    // the best value the next 'depth' ticks from 'state' can get
+    uint32_t search(const State &state, uint64_t hash, int depth, SolverStats &stats)
+    {
+        uint64_t key{table_key(hash, state)};
+        uint32_t best{};
+        stats.table_probes++;
+        if (m_table.probe(key, depth, best))
+        {
+            stats.table_hits++;
+            return best;
+        }
+
+        for (int d{DIRECTION_NORTH}; d <= DIRECTION_EAST; d++)
+        {
+            Direction direction{static_cast<Direction>(d)};
+            if (!can_turn(state, direction))
+            {
+                continue;
+            }
+            State child{state};
+            child.santa_direction = direction;
+            uint32_t value{tick_value(update_game_state(child), child)};
+            stats.nodes++;
+            if (!child.game_over && depth > 1)
+            {
+                value += search(child, m_keys.step(hash, state, child), depth - 1, stats);
+            }
+            best = std::max(best, value);
+        }
+
+        m_table.store(key, depth, best);
+        return best;
+    }
+
+private:
+    ZobristKeys<ROWS, COLS> m_keys;
+    TranspositionTable m_table;
+    ThreadPool m_pool;
+    int m_horizon;
+    std::vector<Branch> m_branches; // the split, one subtree each
+    std::vector<Branch> m_next_branches;
+    std::vector<uint32_t> m_values; // of m_branches, once searched
+    std::atomic<int64_t> m_nodes;
+    std::atomic<int64_t> m_table_probes;
+    std::atomic<int64_t> m_table_hits;
+    double m_elapsed_sec;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// single-producer single-consumer ring buffer
+// lock free and wait free: the producer only ever writes the tail and the
+// consumer the head, each publishing its index with release and reading the
+// other's with acquire. The indices live on separate cache lines, and each side
+// caches the other's index so it only touches the shared line when it looks
+// full (or empty)
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <type_traits>
+
+constexpr size_t CACHE_LINE_SIZE{64};
+
+template <typename T, size_t CAPACITY>
+class SpscRing
+{
+    static_assert(std::has_single_bit(CAPACITY), "the capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "items are copied in and out of the ring");
+
+public:
+    SpscRing() noexcept = default;
+    ~SpscRing() noexcept = default;
+    SpscRing(const SpscRing &) noexcept = delete;
+    SpscRing(SpscRing &&) noexcept = delete;
+    SpscRing &operator=(const SpscRing &) noexcept = delete;
+    SpscRing &operator=(SpscRing &&) noexcept = delete;
+
+public:
+    // producer side; false when the ring is full and the item was not queued
+    bool try_push(const T &item) noexcept
+    {
+        size_t tail{m_tail.load(std::memory_order_relaxed)};
+        if (tail - m_cached_head == CAPACITY)
+        {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            if (tail - m_cached_head == CAPACITY)
+            {
+                return false;
+            }
+        }
+        m_items[tail & (CAPACITY - 1)] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side; false when the ring is empty
+    bool try_pop(T &item) noexcept
+    {
+        size_t head{m_head.load(std::memory_order_relaxed)};
+        if (head == m_cached_tail)
+        {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cached_tail)
+            {
+                return false;
+            }
+        }
+        item = m_items[head & (CAPACITY - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // consumer's line
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{};
+    size_t m_cached_tail{};
+    // producer's line
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{};
+    size_t m_cached_head{};
+    alignas(CACHE_LINE_SIZE) T m_items[CAPACITY]{};
+};
@@ -0,0 +1,114 @@
+// swarm driver: many bots on one shared board, stepped on a single thread, to
+// see how a tick scales with the number of agents. Prints what the agents did,
+// the hash of where they ended up (the same seed always gives the same hash)
+// and how fast the swarm ran, per tick and per agent
+
+#include "sim.hpp"
+#include "swarm.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <random>
+#include <string>
+
+constexpr int DEFAULT_SWARM_AGENTS{1024};
+constexpr int DEFAULT_SWARM_SIDE{256};
+constexpr int64_t DEFAULT_SWARM_TICKS{10'000};
+
+struct SwarmOptions
+{
+    int agents;
+    int64_t ticks;
+    int max_bags;
+    uint64_t seed;
+};
+
+template <typename State>
+static void run_swarm(State state, const SwarmOptions &options)
+{
+    Rng bot_rng{};
+    seed_rng(state.rng, options.seed, 0);
+    seed_rng(bot_rng, options.seed, 1);
+    state.max_bags = options.max_bags;
+    init_swarm_state(state, options.agents);
+
+    SwarmEvents total{};
+    auto start{std::chrono::steady_clock::now()};
+    for (int64_t tick{}; tick < options.ticks; tick++)
+    {
+        steer_swarm_bots(state, bot_rng);
+        SwarmEvents events{update_swarm_state(state)};
+        for (int e{}; e <= GAME_EVENT_SPAWN; e++)
+        {
+            total.counts[e] += events.counts[e];
+        }
+        total.crashes += events.crashes;
+        total.blocked += events.blocked;
+    }
+    double elapsed_sec{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+
+    double agent_ticks{static_cast<double>(options.ticks) * options.agents};
+    std::cout << std::format("seed: {}\n", options.seed);
+    std::cout << std::format("swarm: {} agents on a {}x{} board (room for {} bags each)\n", options.agents, state.board.rows(), state.board.cols(), options.max_bags);
+    std::cout << std::format("ticks: {}\n", options.ticks);
+    std::cout << std::format("steps: {}, gifts: {}, deliveries: {}, spawns: {}\n", total.counts[GAME_EVENT_STEP], total.counts[GAME_EVENT_GIFT], total.counts[GAME_EVENT_HOUSE], total.counts[GAME_EVENT_SPAWN]);
+    std::cout << std::format("out: {} into bags, {} into houses without bags; blocked: {}\n", total.crashes, total.counts[GAME_EVENT_HURT], total.blocked);
+    std::cout << std::format("hash: {:016x}\n", hash_swarm_state(state));
+    std::cout << std::format("elapsed: {:.3f} s\n", elapsed_sec);
+    std::cout << std::format("ticks/sec: {:.0f} ({:.1f} ns per agent)\n", static_cast<double>(options.ticks) / elapsed_sec, elapsed_sec * 1e9 / agent_ticks);
+}
+
+static int entry(int argc, char **argv)
+{
+    SwarmOptions options{DEFAULT_SWARM_AGENTS, DEFAULT_SWARM_TICKS, DEFAULT_SWARM_MAX_BAGS, std::random_device{}()};
+    int side{DEFAULT_SWARM_SIDE};
+    for (int i{1}; i < argc; i++)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--agents" && i + 1 < argc)
+        {
+            options.agents = std::atoi(argv[++i]);
+        }
+        else if (arg == "--ticks" && i + 1 < argc)
+        {
+            options.ticks = std::atoll(argv[++i]);
+        }
+        else if (arg == "--max-bags" && i + 1 < argc)
+        {
+            options.max_bags = std::atoi(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--side" && i + 1 < argc)
+        {
+            side = std::atoi(argv[++i]);
+        }
+        else
+        {
+            error(std::format("unknown argument '{}' (usage: swarm [--agents N] [--ticks N] [--max-bags N] [--seed N] [--side N])", arg));
+        }
+    }
+
+    with_board_state<BasicSwarmState, MAP_SIDE>(side, side, [&options](auto prototype) { run_swarm(prototype, options); });
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    try
+    {
+        return entry(argc, argv);
+    }
+    catch (const Error &error)
+    {
+        std::cerr << error.what() << "\n";
+    }
+
+    return 1;
+}
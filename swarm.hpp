@@ -0,0 +1,417 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// swarm
+// many santas on one shared board. The agents are kept field by field, one
+// array per field indexed by agent, so that every pass over them only touches
+// the fields it needs and the plain ones vectorize. A tick is a few passes:
+//   1. every agent's target tile, from its position and direction
+//   2. claims: nobody moves onto a tile an agent stood on when the tick
+//      started, and of the agents headed for the same tile the lowest index
+//      wins; the others stay put for this tick
+//   3. what is on the target tiles, as it was when the tick started
+//   4. the tile rules, agent by agent in index order, as for a single santa
+//   5. agents that walked into a bag or a house without bags lose their trail
+//      and are placed again on a free tile
+//   6. the spawner, shared by the whole board
+// Everything happens in agent index order and draws from the swarm's own
+// generator, so the same seed always plays out the same way
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <format>
+#include <vector>
+
+constexpr int DEFAULT_SWARM_MAX_BAGS{32};
+constexpr int SWARM_AGENTS_PER_SPAWN{16}; // the spawner drops one gift or house per this many agents
+constexpr int SWARM_PLACE_ATTEMPTS{64};   // draws for a free tile before giving up on it
+
+// what the agents did, summed over all of them
+struct SwarmEvents
+{
+    int64_t counts[GAME_EVENT_SPAWN + 1]; // by GameEvent
+    int64_t crashes; // walked into a bag, their own or another agent's
+    int64_t blocked; // lost a claim, or found a gift with a full trail
+};
+
+template <int ROWS, int COLS>
+struct BasicSwarmState
+{
+    static constexpr int BOARD_ROWS{ROWS}; // DYNAMIC_SIDE for boards sized at runtime
+    static constexpr int BOARD_COLS{COLS};
+
+    Board<ROWS, COLS> board{};
+    int max_bags{DEFAULT_SWARM_MAX_BAGS}; // trail capacity of every agent, set before init_swarm_state
+    double spawn_time_sec{SPAWN_TIME_SEC_START};
+    double spawn_timer{};
+    Rng rng{}; // seed with seed_rng; init_swarm_state leaves it alone
+
+    // one entry per agent
+    std::vector<int32_t> agent_row{};
+    std::vector<int32_t> agent_col{};
+    std::vector<Direction> agent_direction{};
+    std::vector<int32_t> num_bags{};
+    std::vector<int32_t> trail_head{};
+    std::vector<uint32_t> trail_slots{}; // a ring of max_bags packed tile indices per agent, from the first bag to the last
+
+    std::vector<uint64_t> occupied{}; // one bit per tile, set where an agent stands
+
+    // scratch for update_swarm_state, kept between ticks so that a tick does not allocate
+    std::vector<int32_t> target_row{}; // per agent
+    std::vector<int32_t> target_col{}; // per agent
+    std::vector<int32_t> target{}; // per agent, packed tile index
+    std::vector<TileType> target_type{}; // per agent
+    std::vector<uint8_t> is_moving{}; // per agent, won its claim
+    std::vector<uint64_t> claimed{}; // per tile, left clear between ticks
+    std::vector<int32_t> out{}; // agents to place again
+};
+
+using DynamicSwarmState = BasicSwarmState<DYNAMIC_SIDE, DYNAMIC_SIDE>;
+
+template <int ROWS, int COLS>
+inline int num_agents(const BasicSwarmState<ROWS, COLS> &state) noexcept
+{
+    return static_cast<int>(state.agent_row.size());
+}
+
+inline bool test_tile_bit(const std::vector<uint64_t> &bits, int index) noexcept
+{
+    return ((bits[static_cast<size_t>(index / 64)] >> (index % 64)) & 1) != 0;
+}
+
+inline void set_tile_bit(std::vector<uint64_t> &bits, int index, bool value) noexcept
+{
+    uint64_t bit{uint64_t{1} << (index % 64)};
+    uint64_t &word{bits[static_cast<size_t>(index / 64)]};
+    word = value ? word | bit : word & ~bit;
+}
+
+// the same ring operations as the single santa's trail, on agent i's slice of trail_slots
+template <int ROWS, int COLS>
+inline void push_agent_bag(BasicSwarmState<ROWS, COLS> &state, size_t i, int tile) noexcept
+{
+    int32_t &head{state.trail_head[i]};
+    head = head > 0 ? head - 1 : state.max_bags - 1;
+    state.trail_slots[i * static_cast<size_t>(state.max_bags) + static_cast<size_t>(head)] = static_cast<uint32_t>(tile);
+    state.num_bags[i]++;
+}
+
+template <int ROWS, int COLS>
+inline int pop_agent_bag(BasicSwarmState<ROWS, COLS> &state, size_t i) noexcept
+{
+    state.num_bags[i]--;
+    int tail{state.trail_head[i] + state.num_bags[i]};
+    tail = tail < state.max_bags ? tail : tail - state.max_bags;
+    return static_cast<int>(state.trail_slots[i * static_cast<size_t>(state.max_bags) + static_cast<size_t>(tail)]);
+}
+
+// a random tile that is empty, has no agent on it and is not 'excluded'; false if
+// there is none, or if SWARM_PLACE_ATTEMPTS draws only found taken ones
+template <int ROWS, int COLS>
+inline bool pick_free_tile(BasicSwarmState<ROWS, COLS> &state, v2 excluded, v2 &picked)
+{
+    for (int attempt{}; attempt < SWARM_PLACE_ATTEMPTS; attempt++)
+    {
+        if (!pick_empty_tile(state.board, excluded, state.rng, picked))
+        {
+            return false;
+        }
+        if (!test_tile_bit(state.occupied, tile_index(state.board, picked)))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// start a new swarm of 'agents' agents spread evenly over an empty board, facing
+// random directions, without bags
+template <int ROWS, int COLS>
+inline void init_swarm_state(BasicSwarmState<ROWS, COLS> &state, int agents)
+{
+    Board<ROWS, COLS> &board{state.board};
+    int tiles{board.rows() * board.cols()};
+    if (agents <= 0 || agents > tiles)
+    {
+        error(std::format("a swarm needs 1 to {} agents on a {}x{} board (got {})", tiles, board.rows(), board.cols(), agents));
+    }
+    if (state.max_bags <= 0)
+    {
+        error(std::format("agents need room for at least one bag (got {})", state.max_bags));
+    }
+    clear_board(board);
+
+    size_t size{static_cast<size_t>(agents)};
+    size_t words{static_cast<size_t>(board.words())};
+    state.agent_row.assign(size, 0);
+    state.agent_col.assign(size, 0);
+    state.agent_direction.assign(size, DIRECTION_WEST);
+    state.num_bags.assign(size, 0);
+    state.trail_head.assign(size, 0);
+    state.trail_slots.assign(size * static_cast<size_t>(state.max_bags), 0);
+    state.occupied.assign(words, 0);
+    state.target_row.assign(size, 0);
+    state.target_col.assign(size, 0);
+    state.target.assign(size, 0);
+    state.target_type.assign(size, TILE_EMPTY);
+    state.is_moving.assign(size, 0);
+    state.claimed.assign(words, 0);
+    state.out.clear();
+
+    int stride{tiles / agents};
+    for (size_t i{}; i < size; i++)
+    {
+        int tile{static_cast<int>(i) * stride + stride / 2};
+        v2 position{index_tile(board, tile)};
+        state.agent_row[i] = position.row;
+        state.agent_col[i] = position.col;
+        state.agent_direction[i] = static_cast<Direction>(random_int(state.rng, DIRECTION_NORTH, DIRECTION_EAST));
+        set_tile_bit(state.occupied, tile, true);
+    }
+
+    state.spawn_time_sec = SPAWN_TIME_SEC_START;
+    state.spawn_timer = 0.0;
+}
+
+// advance every agent by exactly one tick and sum up what they did
+template <int ROWS, int COLS>
+inline SwarmEvents update_swarm_state(BasicSwarmState<ROWS, COLS> &state)
+{
+    SwarmEvents events{};
+    Board<ROWS, COLS> &board{state.board};
+    int agents{num_agents(state)};
+    int rows{board.rows()};
+    int cols{board.cols()};
+    int32_t *agent_row{state.agent_row.data()};
+    int32_t *agent_col{state.agent_col.data()};
+    const Direction *agent_direction{state.agent_direction.data()};
+    int32_t *target_row{state.target_row.data()};
+    int32_t *target_col{state.target_col.data()};
+    int32_t *target{state.target.data()};
+    TileType *target_type{state.target_type.data()};
+    uint8_t *is_moving{state.is_moving.data()};
+
+    // the target tiles; compares instead of the wrap tables, so that the loop
+    // has no lookups and vectorizes
+    for (int i{}; i < agents; i++)
+    {
+        int direction{agent_direction[i]};
+        int row{agent_row[i] + (direction == DIRECTION_SOUTH) - (direction == DIRECTION_NORTH)};
+        int col{agent_col[i] + (direction == DIRECTION_EAST) - (direction == DIRECTION_WEST)};
+        row = row < 0 ? rows - 1 : (row < rows ? row : 0);
+        col = col < 0 ? cols - 1 : (col < cols ? col : 0);
+        target_row[i] = row;
+        target_col[i] = col;
+        target[i] = row * cols + col;
+    }
+
+    // claims, first come first served in index order; 'claimed' only ever has
+    // target bits set, so clearing the targets' words leaves all of it clear
+    uint64_t *occupied{state.occupied.data()};
+    uint64_t *claimed{state.claimed.data()};
+    for (int i{}; i < agents; i++)
+    {
+        int word{target[i] / 64};
+        uint64_t bit{uint64_t{1} << (target[i] % 64)};
+        is_moving[i] = ((occupied[word] | claimed[word]) & bit) == 0;
+        claimed[word] |= bit;
+    }
+    for (int i{}; i < agents; i++)
+    {
+        claimed[target[i] / 64] = 0;
+    }
+
+    // every target is read before any agent moves, so no agent sees what
+    // another did earlier in the same tick
+    for (int i{}; i < agents; i++)
+    {
+        target_type[i] = tile_at_index(board, target[i]);
+    }
+
+    // the rules, as update_game_state runs them for a single santa
+    state.out.clear();
+    for (int i{}; i < agents; i++)
+    {
+        size_t agent{static_cast<size_t>(i)};
+        if (!is_moving[i])
+        {
+            events.blocked++;
+            continue;
+        }
+        const TileRule &rule{TILE_RULES[target_type[i]]};
+        if (rule.is_blocked || (rule.needs_bags && state.num_bags[agent] <= 0))
+        {
+            if (rule.is_blocked)
+            {
+                events.crashes++;
+            }
+            else
+            {
+                events.counts[GAME_EVENT_HURT]++;
+            }
+            // the agent is out: its bags go with it, and it is placed again below
+            while (state.num_bags[agent] > 0)
+            {
+                set_tile_at_index(board, pop_agent_bag(state, agent), TILE_EMPTY);
+            }
+            state.out.push_back(i);
+            continue;
+        }
+        if (rule.gives_bag && state.num_bags[agent] >= state.max_bags)
+        {
+            events.blocked++;
+            continue;
+        }
+
+        int from{agent_row[i] * cols + agent_col[i]};
+        int to{target[i]};
+        occupied[from / 64] &= ~(uint64_t{1} << (from % 64));
+        occupied[to / 64] |= uint64_t{1} << (to % 64);
+        agent_row[i] = target_row[i];
+        agent_col[i] = target_col[i];
+
+        if (target_type[i] != TILE_EMPTY)
+        {
+            set_tile_at_index(board, to, TILE_EMPTY);
+        }
+        if (rule.takes_bag)
+        {
+            set_tile_at_index(board, pop_agent_bag(state, agent), TILE_EMPTY);
+        }
+        // the last bag goes before the new one comes in: a full ring has no
+        // slot for the new bag until then
+        bool is_following{!rule.gives_bag && state.num_bags[agent] > 0};
+        if (is_following)
+        {
+            set_tile_at_index(board, pop_agent_bag(state, agent), TILE_EMPTY);
+        }
+        if (rule.gives_bag || is_following)
+        {
+            set_tile_at_index(board, from, TILE_BAG);
+            push_agent_bag(state, agent, from);
+        }
+
+        events.counts[rule.event]++;
+    }
+
+    // agents that are out start over on a free tile, or where they are if there
+    // is none; their old tile is empty, it was never taken off 'occupied'
+    for (int i : state.out)
+    {
+        size_t agent{static_cast<size_t>(i)};
+        v2 here{agent_row[i], agent_col[i]};
+        v2 there{};
+        if (pick_free_tile(state, here, there))
+        {
+            set_tile_bit(state.occupied, tile_index(board, here), false);
+            set_tile_bit(state.occupied, tile_index(board, there), true);
+            agent_row[i] = there.row;
+            agent_col[i] = there.col;
+        }
+        state.trail_head[agent] = 0;
+        state.agent_direction[agent] = static_cast<Direction>(random_int(state.rng, DIRECTION_NORTH, DIRECTION_EAST));
+    }
+
+    // one spawner for the whole board, on the same clock as a single game's,
+    // dropping as many items as there are agents to share them
+    if (state.spawn_timer >= state.spawn_time_sec)
+    {
+        int spawns{std::max(1, agents / SWARM_AGENTS_PER_SPAWN)};
+        // agent 0's tile is never free, so excluding it changes nothing
+        v2 excluded{agent_row[0], agent_col[0]};
+        for (int spawn{}; spawn < spawns; spawn++)
+        {
+            v2 tile{};
+            if (pick_free_tile(state, excluded, tile))
+            {
+                set_tile(board, tile, random_int(state.rng, 1, 100) <= 50 ? TILE_GIFT : TILE_HOUSE);
+                events.counts[GAME_EVENT_SPAWN]++;
+            }
+        }
+
+        state.spawn_time_sec -= SPAWN_TIME_DIFFICULTY_COEFFICIENT * state.spawn_time_sec;
+        state.spawn_time_sec = std::max(state.spawn_time_sec, MIN_SPAWN_TIME_SEC);
+        state.spawn_timer = 0.0;
+    }
+    state.spawn_timer += SEC_PER_TICK;
+
+    return events;
+}
+
+// bots for every agent: each turns randomly now and then, never back onto its
+// bags, and looks one tile ahead to keep out of bags, out of houses without bags
+// of its own, away from gifts it has no room for and from other agents, which
+// would block it. 'rng' is the bots' own, so that they don't perturb spawns
+template <int ROWS, int COLS>
+inline void steer_swarm_bots(BasicSwarmState<ROWS, COLS> &state, Rng &rng)
+{
+    const Board<ROWS, COLS> &board{state.board};
+    for (size_t i{}; i < state.agent_row.size(); i++)
+    {
+        Direction current{state.agent_direction[i]};
+        bool has_bags{state.num_bags[i] > 0};
+        bool is_full{state.num_bags[i] >= state.max_bags};
+        Direction wanted{current};
+        if (random_int(rng, 1, 4) == 1)
+        {
+            wanted = static_cast<Direction>(random_int(rng, DIRECTION_NORTH, DIRECTION_EAST));
+        }
+
+        // the wanted direction if it is safe, otherwise the next safe one
+        for (int turn{}; turn < 4; turn++)
+        {
+            Direction direction{static_cast<Direction>((wanted + turn) % 4)};
+            if (has_bags && direction == opposite_direction(current))
+            {
+                continue;
+            }
+            v2 delta{DIRECTION_DELTA[direction]};
+            int tile{tile_index(board, v2{board.wrap_row(state.agent_row[i] + delta.row), board.wrap_col(state.agent_col[i] + delta.col)})};
+            TileType ahead{tile_at_index(board, tile)};
+            if (ahead != TILE_BAG && (ahead != TILE_HOUSE || has_bags) && (ahead != TILE_GIFT || !is_full) && !test_tile_bit(state.occupied, tile))
+            {
+                state.agent_direction[i] = direction;
+                break;
+            }
+        }
+    }
+}
+
+// fnv-1a over everything that decides how the swarm goes on from here
+template <int ROWS, int COLS>
+inline uint64_t hash_swarm_state(const BasicSwarmState<ROWS, COLS> &state) noexcept
+{
+    const Board<ROWS, COLS> &board{state.board};
+    uint64_t hash{FNV_OFFSET_BASIS};
+    hash = hash_u64(hash, static_cast<uint64_t>(board.rows()));
+    hash = hash_u64(hash, static_cast<uint64_t>(board.cols()));
+    for (TileType type : {TILE_BAG, TILE_GIFT, TILE_HOUSE})
+    {
+        for (int word{}; word < board.words(); word++)
+        {
+            hash = hash_u64(hash, board.mask(type)[word]);
+        }
+    }
+    for (size_t i{}; i < state.agent_row.size(); i++)
+    {
+        hash = hash_u64(hash, static_cast<uint64_t>(state.agent_row[i]));
+        hash = hash_u64(hash, static_cast<uint64_t>(state.agent_col[i]));
+        hash = hash_u64(hash, state.agent_direction[i]);
+        hash = hash_u64(hash, static_cast<uint64_t>(state.num_bags[i]));
+        // the trail from first to last bag, wherever it sits in the ring
+        for (int bag{}; bag < state.num_bags[i]; bag++)
+        {
+            size_t slot{static_cast<size_t>((state.trail_head[i] + bag) % state.max_bags)};
+            hash = hash_u64(hash, state.trail_slots[i * static_cast<size_t>(state.max_bags) + slot]);
+        }
+    }
+    hash = hash_u64(hash, std::bit_cast<uint64_t>(state.spawn_time_sec));
+    hash = hash_u64(hash, std::bit_cast<uint64_t>(state.spawn_timer));
+    hash = hash_u64(hash, state.rng.state);
+    hash = hash_u64(hash, state.rng.increment);
+    return hash;
+}
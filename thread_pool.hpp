@@ -0,0 +1,164 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// work-stealing thread pool
+// every worker owns a deque: it pushes and pops its own tasks at the back and,
+// when it runs dry, steals from the front of the other workers' deques
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+public:
+    explicit ThreadPool(int num_threads)
+        : m_workers{}, m_threads{}, m_wake_mutex{}, m_wake{}, m_idle{}, m_queued{}, m_pending{}, m_next_worker{}, m_stop{}
+    {
+        if (num_threads <= 0)
+        {
+            error(std::format("thread pool needs at least one thread (got {})", num_threads));
+        }
+
+        for (int i{}; i < num_threads; i++)
+        {
+            m_workers.push_back(std::make_unique<Worker>());
+        }
+        for (int i{}; i < num_threads; i++)
+        {
+            m_threads.emplace_back([this, i]() { worker_loop(i); });
+        }
+    }
+    ~ThreadPool() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_wake_mutex};
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (std::thread &thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+    ThreadPool(const ThreadPool &) noexcept = delete;
+    ThreadPool(ThreadPool &&) noexcept = delete;
+    ThreadPool &operator=(const ThreadPool &) noexcept = delete;
+    ThreadPool &operator=(ThreadPool &&) noexcept = delete;
+
+public:
+    int size() const noexcept { return static_cast<int>(m_workers.size()); }
+
+    // queue a task; tasks are spread round robin, idle workers steal the rest
+    void submit(Task task)
+    {
+        size_t index{m_next_worker.fetch_add(1, std::memory_order_relaxed) % m_workers.size()};
+        m_pending.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock{m_workers[index]->mutex};
+            m_workers[index]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock{m_wake_mutex};
+            m_queued++;
+        }
+        m_wake.notify_one();
+    }
+
+    // block until every submitted task has finished running
+    void wait_idle()
+    {
+        std::unique_lock<std::mutex> lock{m_wake_mutex};
+        m_idle.wait(lock, [this]() { return m_pending.load(std::memory_order_acquire) == 0; });
+    }
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+private:
+    bool try_pop(size_t index, Task &task)
+    {
+        Worker &worker{*m_workers[index]};
+        std::lock_guard<std::mutex> lock{worker.mutex};
+        if (worker.tasks.empty())
+        {
+            return false;
+        }
+        task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        return true;
+    }
+    bool try_steal(size_t thief, Task &task)
+    {
+        for (size_t i{1}; i < m_workers.size(); i++)
+        {
+            Worker &victim{*m_workers[(thief + i) % m_workers.size()]};
+            std::lock_guard<std::mutex> lock{victim.mutex};
+            if (!victim.tasks.empty())
+            {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+    void worker_loop(int worker_index)
+    {
+        size_t index{static_cast<size_t>(worker_index)};
+        while (true)
+        {
+            // sleep until there is something queued somewhere (or we are asked to stop)
+            {
+                std::unique_lock<std::mutex> lock{m_wake_mutex};
+                m_wake.wait(lock, [this]() { return m_stop || m_queued > 0; });
+                if (m_stop)
+                {
+                    return;
+                }
+                m_queued--;
+            }
+
+            // we reserved one queued task above, so one of the deques has it
+            Task task{};
+            while (!try_pop(index, task) && !try_steal(index, task))
+            {
+                std::this_thread::yield();
+            }
+            task();
+
+            if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                std::lock_guard<std::mutex> lock{m_wake_mutex};
+                m_idle.notify_all();
+            }
+        }
+    }
+
+private:
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    int64_t m_queued; // guarded by m_wake_mutex
+    std::atomic<int64_t> m_pending;
+    std::atomic<size_t> m_next_worker;
+    bool m_stop; // guarded by m_wake_mutex
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// transposition table
+// a fixed-size hash table of search results shared by every search thread
+// without locks. An entry is two relaxed atomic words, the result and the key
+// xored with the result; a reader only trusts an entry whose two words agree,
+// so an entry torn by two threads writing at once just reads as a miss.
+// Newer results always replace older ones in the same slot
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+#include "spsc_ring.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <format>
+#include <memory>
+
+constexpr int MAX_TRANSPOSITION_TABLE_BITS{32};
+
+class TranspositionTable
+{
+public:
+    // 2^bits entries of 16 bytes
+    explicit TranspositionTable(int bits)
+        : m_entries{}, m_mask{}
+    {
+        if (bits <= 0 || bits > MAX_TRANSPOSITION_TABLE_BITS)
+        {
+            error(std::format("transposition table size must be 2^1 to 2^{} entries (got 2^{})", MAX_TRANSPOSITION_TABLE_BITS, bits));
+        }
+        size_t size{size_t{1} << bits};
+        m_entries = std::make_unique<Entry[]>(size);
+        m_mask = size - 1;
+    }
+    ~TranspositionTable() noexcept = default;
+    TranspositionTable(const TranspositionTable &) noexcept = delete;
+    TranspositionTable(TranspositionTable &&) noexcept = delete;
+    TranspositionTable &operator=(const TranspositionTable &) noexcept = delete;
+    TranspositionTable &operator=(TranspositionTable &&) noexcept = delete;
+
+public:
+    // the value stored for 'key' searched 'depth' ticks deep, if there is one
+    bool probe(uint64_t key, int depth, uint32_t &value) const noexcept
+    {
+        const Entry &entry{m_entries[key & m_mask]};
+        uint64_t data{entry.data.load(std::memory_order_relaxed)};
+        uint64_t check{entry.check.load(std::memory_order_relaxed)};
+        if ((check ^ data) != key || static_cast<int>(data >> 32) != depth)
+        {
+            return false;
+        }
+        value = static_cast<uint32_t>(data);
+        return true;
+    }
+
+    void store(uint64_t key, int depth, uint32_t value) noexcept
+    {
+        Entry &entry{m_entries[key & m_mask]};
+        uint64_t data{(static_cast<uint64_t>(depth) << 32) | value};
+        entry.data.store(data, std::memory_order_relaxed);
+        entry.check.store(key ^ data, std::memory_order_relaxed);
+    }
+
+    size_t size() const noexcept { return m_mask + 1; }
+
+private:
+    struct alignas(16) Entry
+    {
+        std::atomic<uint64_t> check; // key ^ data
+        std::atomic<uint64_t> data;  // depth << 32 | value
+    };
+    static_assert(CACHE_LINE_SIZE % sizeof(Entry) == 0, "entries must not straddle cache lines");
+
+private:
+    std::unique_ptr<Entry[]> m_entries;
+    size_t m_mask;
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// triple buffer
+// hands the latest value from one producer thread to one consumer thread
+// without either ever waiting: the producer fills its back slot and swaps it
+// with the middle one, the consumer swaps its front slot with the middle one
+// when the middle holds something newer. Values the consumer was too slow to
+// pick up are overwritten, so it always sees the newest
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+#include "spsc_ring.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() noexcept = default;
+    ~TripleBuffer() noexcept = default;
+    TripleBuffer(const TripleBuffer &) noexcept = delete;
+    TripleBuffer(TripleBuffer &&) noexcept = delete;
+    TripleBuffer &operator=(const TripleBuffer &) noexcept = delete;
+    TripleBuffer &operator=(TripleBuffer &&) noexcept = delete;
+
+public:
+    // producer side: fill back(), then publish() it
+    T &back() noexcept { return m_slots[m_back]; }
+    void publish() noexcept
+    {
+        m_back = static_cast<uint8_t>(m_middle.exchange(static_cast<uint8_t>(m_back | FRESH), std::memory_order_acq_rel) & SLOT);
+    }
+
+    // consumer side: take the newest published value if there is one (false if
+    // front() is still the newest); front() stays put until the next call
+    bool acquire() noexcept
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & FRESH) == 0)
+        {
+            return false;
+        }
+        m_front = static_cast<uint8_t>(m_middle.exchange(m_front, std::memory_order_acq_rel) & SLOT);
+        return true;
+    }
+    const T &front() const noexcept { return m_slots[m_front]; }
+
+private:
+    static constexpr uint8_t SLOT{0x3};   // the middle slot's index, in the low bits
+    static constexpr uint8_t FRESH{0x4};  // set when the middle slot was published and not yet acquired
+
+private:
+    T m_slots[3]{};
+    alignas(CACHE_LINE_SIZE) std::atomic<uint8_t> m_middle{1};
+    alignas(CACHE_LINE_SIZE) uint8_t m_back{0};  // producer's
+    alignas(CACHE_LINE_SIZE) uint8_t m_front{2}; // consumer's
+};
@@ -0,0 +1,154 @@
+#pragma once
+
+// ----------------------------------------------------------------------------
+// zobrist hashing
+// a random key per (tile, what is on it), per santa tile and per direction;
+// a state hashes to the xor of the keys of everything in it, so a tick only
+// xors in and out the few keys of what it changed. Bags are keyed together
+// with the way to the bag (or santa) ahead of them, which pins down the order
+// of the trail and never changes while the bag lies there
+// ----------------------------------------------------------------------------
+
+#include "sim.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+constexpr uint64_t ZOBRIST_SEED{0x5a6f627269737421ULL}; // the keys are the same on every run
+
+// splitmix64's finalizer, to spread values that are not keys (the generator, the timers) over all bits
+inline uint64_t mix_u64(uint64_t value) noexcept
+{
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+// the way from 'from' to the neighboring tile 'to', across the edges too
+template <typename BoardT>
+inline Direction neighbor_direction(const BoardT &board, int from, int to) noexcept
+{
+    v2 a{index_tile(board, from)};
+    v2 b{index_tile(board, to)};
+    if (a.row == b.row)
+    {
+        return b.col == (a.col + 1 < board.cols() ? a.col + 1 : 0) ? DIRECTION_EAST : DIRECTION_WEST;
+    }
+    return b.row == (a.row + 1 < board.rows() ? a.row + 1 : 0) ? DIRECTION_SOUTH : DIRECTION_NORTH;
+}
+
+// keys for one board size; hash() a state once, then step() it along every tick
+template <int ROWS, int COLS>
+class ZobristKeys
+{
+public:
+    using State = BasicGameState<ROWS, COLS>;
+
+public:
+    explicit ZobristKeys(const State &prototype)
+        : m_gift{}, m_house{}, m_bag{}, m_santa{}, m_direction{}
+    {
+        Rng rng{};
+        seed_rng(rng, ZOBRIST_SEED);
+        auto next_key{[&rng]() { return (static_cast<uint64_t>(next_u32(rng)) << 32) | next_u32(rng); }};
+        size_t tiles{static_cast<size_t>(prototype.board.rows() * prototype.board.cols())};
+        for (std::vector<uint64_t> *keys : {&m_gift, &m_house, &m_santa})
+        {
+            keys->resize(tiles);
+        }
+        m_bag.resize(tiles * 4);
+        for (std::vector<uint64_t> *keys : {&m_gift, &m_house, &m_bag, &m_santa})
+        {
+            for (uint64_t &key : *keys)
+            {
+                key = next_key();
+            }
+        }
+        for (uint64_t &key : m_direction)
+        {
+            key = next_key();
+        }
+    }
+
+public:
+    // from scratch, for the first state of a search
+    uint64_t hash(const State &state) const noexcept
+    {
+        uint64_t hash{};
+        hash ^= mask_keys(state.board.mask(TILE_GIFT), state.board.words(), m_gift);
+        hash ^= mask_keys(state.board.mask(TILE_HOUSE), state.board.words(), m_house);
+        for (int i{}; i < state.num_bags; i++)
+        {
+            hash ^= bag_key(state, i);
+        }
+        hash ^= m_santa[static_cast<size_t>(tile_index(state.board, state.santa))];
+        hash ^= m_direction[state.santa_direction];
+        return hash;
+    }
+
+    // the hash of 'after', the state one update_game_state() past 'before' (whose
+    // hash is 'hash'); a tick that ended the game is not worth hashing
+    uint64_t step(uint64_t hash, const State &before, const State &after) const noexcept
+    {
+        hash ^= m_santa[static_cast<size_t>(tile_index(before.board, before.santa))] ^ m_santa[static_cast<size_t>(tile_index(after.board, after.santa))];
+        hash ^= m_direction[before.santa_direction] ^ m_direction[after.santa_direction];
+
+        // gifts and houses: only the tiles that changed, picked up, delivered to or spawned
+        for (int word{}; word < before.board.words(); word++)
+        {
+            hash ^= word_keys(before.board.mask(TILE_GIFT)[word] ^ after.board.mask(TILE_GIFT)[word], word, m_gift);
+            hash ^= word_keys(before.board.mask(TILE_HOUSE)[word] ^ after.board.mask(TILE_HOUSE)[word], word, m_house);
+        }
+
+        // bags: whenever any are left there is a new first one where santa was, and
+        // whatever that does not account for came off the end of the trail
+        int added{after.num_bags > 0 ? 1 : 0};
+        int removed{before.num_bags + added - after.num_bags};
+        for (int i{}; i < removed; i++)
+        {
+            hash ^= bag_key(before, before.num_bags - 1 - i);
+        }
+        if (added > 0)
+        {
+            hash ^= bag_key(after, 0);
+        }
+        return hash;
+    }
+
+private:
+    uint64_t mask_keys(const uint64_t *mask, int words, const std::vector<uint64_t> &keys) const noexcept
+    {
+        uint64_t hash{};
+        for (int word{}; word < words; word++)
+        {
+            hash ^= word_keys(mask[word], word, keys);
+        }
+        return hash;
+    }
+
+    uint64_t word_keys(uint64_t bits, int word, const std::vector<uint64_t> &keys) const noexcept
+    {
+        uint64_t hash{};
+        for (; bits; bits &= bits - 1)
+        {
+            hash ^= keys[static_cast<size_t>(word * 64 + std::countr_zero(bits))];
+        }
+        return hash;
+    }
+
+    // the i-th bag, keyed with the way to the bag ahead of it (santa for the first)
+    uint64_t bag_key(const State &state, int i) const noexcept
+    {
+        int tile{tile_index(state.board, bag_at(state, i))};
+        int ahead{tile_index(state.board, i > 0 ? bag_at(state, i - 1) : state.santa)};
+        return m_bag[static_cast<size_t>(tile) * 4 + neighbor_direction(state.board, tile, ahead)];
+    }
+
+private:
+    std::vector<uint64_t> m_gift;
+    std::vector<uint64_t> m_house;
+    std::vector<uint64_t> m_bag; // 4 per tile, one per way to the bag ahead
+    std::vector<uint64_t> m_santa;
+    uint64_t m_direction[4];
+};